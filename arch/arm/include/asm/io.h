@@ -57,7 +57,8 @@ extern void __raw_readsl(const void __iomem *addr, void *data, int longlen);
 #define __raw_write_logged(v, a, _t)	({ \
 	int _ret; \
 	void *_addr = (void *)(a); \
-	_ret = uncached_logk(LOGK_WRITEL, _addr); \
+	_ret = msm_rtb_type_enabled(LOGK_WRITEL) ? \
+		uncached_logk(LOGK_WRITEL, _addr) : 0; \
 	ETB_WAYPOINT; \
 	__raw_write##_t##_no_log((v), _addr); \
 	if (_ret) \
@@ -82,7 +83,8 @@ extern void __raw_readsl(const void __iomem *addr, void *data, int longlen);
 	unsigned _t __a; \
 	void *_addr = (void *)(a); \
 	int _ret; \
-	_ret = uncached_logk(LOGK_READL, _addr); \
+	_ret = msm_rtb_type_enabled(LOGK_READL) ? \
+		uncached_logk(LOGK_READL, _addr) : 0; \
 	ETB_WAYPOINT; \
 	__a = __raw_read##_l##_no_log(_addr);\
 	if (_ret) \
@@ -0,0 +1,33 @@
+/*
+ * linux/arch/arm/include/asm/neon.h
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#ifndef __ASM_ARM_NEON_H
+#define __ASM_ARM_NEON_H
+
+#include <linux/types.h>
+#include <asm/hwcap.h>
+
+#define cpu_has_neon()		(!!(elf_hwcap & HWCAP_NEON))
+
+/*
+ * NEON code in the kernel must be bracketed by these two calls, which
+ * save the current owner's VFP/NEON state and keep preemption disabled
+ * in between. They must not be called from the compilation unit that
+ * contains the NEON code itself, as GCC may hoist NEON instructions
+ * above kernel_neon_begin() there; keep the NEON code in a separate
+ * file built with -mfpu=neon.
+ */
+void kernel_neon_begin(void);
+void kernel_neon_end(void);
+
+#ifdef CONFIG_NEON_MEMCPY
+/* Forced NEON and integer-only copies, for measuring the two paths. */
+void *memcpy_neon(void *dst, const void *src, size_t n);
+void *memcpy_arm(void *dst, const void *src, size_t n);
+#endif
+
+#endif /* __ASM_ARM_NEON_H */
@@ -0,0 +1,150 @@
+/* Copyright (c) 2012, Code Aurora Forum. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+/*
+ * Large memcpy()/memset() through NEON.
+ *
+ * memcpy.S and memset.S branch here for sizes of at least
+ * neon_copy_threshold. The unaligned head and the sub-64 byte tail are
+ * done by the integer routines, the body by the NEON loops. Callers in
+ * interrupt context or with interrupts disabled stay on the integer path,
+ * since kernel_neon_begin() may not be used there.
+ */
+
+#include <linux/module.h>
+#include <linux/types.h>
+#include <linux/kernel.h>
+#include <linux/hardirq.h>
+#include <linux/irqflags.h>
+#include <linux/moduleparam.h>
+#include <asm/neon.h>
+
+/* Below this the VFP state save costs more than NEON gains. */
+#define NEON_COPY_MIN_SIZE	128
+
+/* Read by memcpy.S and memset.S; UINT_MAX keeps NEON disabled. */
+unsigned int neon_copy_threshold __read_mostly = UINT_MAX;
+
+static unsigned int neon_copy_pld_distance __read_mostly =
+	CONFIG_NEON_MEMCPY_PLD_DISTANCE;
+module_param_named(pld_distance, neon_copy_pld_distance, uint, 0644);
+MODULE_PARM_DESC(pld_distance, "Bytes ahead of the source to preload");
+
+asmlinkage void *__memcpy_arm(void *dst, const void *src, size_t n);
+asmlinkage void __memset_arm(void *dst, int c, size_t n);
+asmlinkage void __memcpy_neon(void *dst, const void *src, size_t n,
+			      unsigned int pld_distance);
+asmlinkage void __memset_neon(void *dst, int c, size_t n);
+
+static inline bool neon_copy_allowed(void)
+{
+	return !in_interrupt() && !irqs_disabled();
+}
+
+void *memcpy_neon_large(void *dst, const void *src, size_t n)
+{
+	size_t head, body;
+
+	if (!neon_copy_allowed())
+		return __memcpy_arm(dst, src, n);
+
+	head = -(unsigned long)dst & 63;
+	if (head)
+		__memcpy_arm(dst, src, head);
+	body = (n - head) & ~63;
+
+	kernel_neon_begin();
+	__memcpy_neon(dst + head, src + head, body, neon_copy_pld_distance);
+	kernel_neon_end();
+
+	n -= head + body;
+	if (n)
+		__memcpy_arm(dst + head + body, src + head + body, n);
+	return dst;
+}
+
+void *memset_neon_large(void *dst, int c, size_t n)
+{
+	size_t head, body;
+
+	if (!neon_copy_allowed()) {
+		__memset_arm(dst, c, n);
+		return dst;
+	}
+
+	head = -(unsigned long)dst & 63;
+	if (head)
+		__memset_arm(dst, c, head);
+	body = (n - head) & ~63;
+
+	kernel_neon_begin();
+	__memset_neon(dst + head, c, body);
+	kernel_neon_end();
+
+	n -= head + body;
+	if (n)
+		__memset_arm(dst + head + body, c, n);
+	return dst;
+}
+
+/* Copies through NEON whatever the size, for the benchmark module. */
+void *memcpy_neon(void *dst, const void *src, size_t n)
+{
+	if (n < NEON_COPY_MIN_SIZE || !cpu_has_neon())
+		return __memcpy_arm(dst, src, n);
+	return memcpy_neon_large(dst, src, n);
+}
+EXPORT_SYMBOL(memcpy_neon);
+
+/* Integer-only copy, for the benchmark module. */
+void *memcpy_arm(void *dst, const void *src, size_t n)
+{
+	return __memcpy_arm(dst, src, n);
+}
+EXPORT_SYMBOL(memcpy_arm);
+
+static int neon_copy_set_threshold(const char *val,
+				   const struct kernel_param *kp)
+{
+	unsigned int threshold;
+	int ret;
+
+	ret = kstrtouint(val, 0, &threshold);
+	if (ret)
+		return ret;
+	if (!cpu_has_neon())
+		return -ENODEV;
+
+	neon_copy_threshold = max_t(unsigned int, threshold,
+				    NEON_COPY_MIN_SIZE);
+	return 0;
+}
+
+static struct kernel_param_ops neon_copy_threshold_ops = {
+	.set = neon_copy_set_threshold,
+	.get = param_get_uint,
+};
+module_param_cb(threshold, &neon_copy_threshold_ops, &neon_copy_threshold,
+		0644);
+MODULE_PARM_DESC(threshold,
+	"Smallest memcpy/memset done with NEON, 4294967295 disables");
+
+/* HWCAP_NEON is only known once vfp_init() has run. */
+static int __init neon_copy_init(void)
+{
+	if (cpu_has_neon())
+		neon_copy_threshold = max_t(unsigned int,
+				CONFIG_NEON_MEMCPY_THRESHOLD,
+				NEON_COPY_MIN_SIZE);
+	return 0;
+}
+late_initcall_sync(neon_copy_init);
@@ -0,0 +1,121 @@
+/* Copyright (c) 2012, Code Aurora Forum. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+/*
+ * memcpy() bandwidth benchmark.
+ *
+ * Reading /sys/kernel/debug/neon_copy_bench copies between two buffers
+ * with the integer and the NEON routines for sizes from 64 bytes up to
+ * max_size, and reports MB/s for each. The results are meant for picking
+ * the neon_copy threshold and pld_distance parameters on a given SoC.
+ */
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/sched.h>
+#include <linux/vmalloc.h>
+#include <linux/math64.h>
+#include <asm/neon.h>
+#include <asm/sizes.h>
+
+static unsigned int max_size = SZ_1M;
+module_param(max_size, uint, 0644);
+MODULE_PARM_DESC(max_size, "Largest copy size measured");
+
+static unsigned int total_bytes = 64 * SZ_1M;
+module_param(total_bytes, uint, 0644);
+MODULE_PARM_DESC(total_bytes, "Bytes copied per measurement");
+
+static struct dentry *bench_dent;
+
+static u64 bench_one(void *(*copy)(void *, const void *, size_t),
+		     void *dst, const void *src, size_t size)
+{
+	unsigned int loops = max_t(unsigned int, total_bytes / size, 1);
+	unsigned int i;
+	u64 t0, ns;
+
+	/* warm up the caches and TLBs */
+	copy(dst, src, size);
+
+	t0 = sched_clock();
+	for (i = 0; i < loops; i++)
+		copy(dst, src, size);
+	ns = sched_clock() - t0;
+
+	if (!ns)
+		return 0;
+	/* bytes per microsecond is MB/s */
+	return div64_u64((u64)loops * size * 1000, ns);
+}
+
+static int bench_show(struct seq_file *m, void *unused)
+{
+	void *src, *dst;
+	size_t size;
+
+	src = vmalloc(max_size);
+	dst = vmalloc(max_size);
+	if (!src || !dst) {
+		vfree(src);
+		vfree(dst);
+		return -ENOMEM;
+	}
+	memset(src, 0x5a, max_size);
+
+	seq_printf(m, "%10s %10s %10s\n", "size", "arm MB/s", "neon MB/s");
+	for (size = 64; size <= max_size; size <<= 1) {
+		u64 arm = bench_one(memcpy_arm, dst, src, size);
+		u64 neon = bench_one(memcpy_neon, dst, src, size);
+
+		seq_printf(m, "%10zu %10llu %10llu\n", size, arm, neon);
+		cond_resched();
+	}
+
+	vfree(src);
+	vfree(dst);
+	return 0;
+}
+
+static int bench_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, bench_show, NULL);
+}
+
+static const struct file_operations bench_fops = {
+	.open		= bench_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init neon_copy_bench_init(void)
+{
+	bench_dent = debugfs_create_file("neon_copy_bench", 0400, NULL, NULL,
+					 &bench_fops);
+	if (IS_ERR_OR_NULL(bench_dent))
+		return -ENOMEM;
+	return 0;
+}
+
+static void __exit neon_copy_bench_exit(void)
+{
+	debugfs_remove(bench_dent);
+}
+
+module_init(neon_copy_bench_init);
+module_exit(neon_copy_bench_exit);
+
+MODULE_LICENSE("GPL v2");
+MODULE_DESCRIPTION("memcpy bandwidth benchmark");
@@ -71,6 +71,10 @@ static int bam_adaptive_timer_enabled = 1;
 module_param_named(adaptive_timer_enabled,
 			bam_adaptive_timer_enabled,
 		   int, S_IRUGO | S_IWUSR | S_IWGRP);
+static int bam_dl_aggregation_enabled = 1;
+module_param_named(dl_aggregation_enabled,
+			bam_dl_aggregation_enabled,
+		   int, S_IRUGO | S_IWUSR | S_IWGRP);
 
 #if defined(DEBUG)
 static uint32_t bam_dmux_read_cnt;
@@ -165,6 +169,8 @@ struct tx_pkt_info {
 struct rx_pkt_info {
 	struct sk_buff *skb;
 	dma_addr_t dma_address;
+	uint32_t len;
+	uint32_t sps_size;
 	struct work_struct work;
 	struct list_head list_node;
 };
@@ -176,6 +182,9 @@ struct rx_pkt_info {
 #define A2_PHYS_SIZE		0x2000
 #define BUFFER_SIZE		2048
 #define NUM_BUFFERS		32
+#define MAX_NUM_BUFFERS		128
+#define NUM_BUFFERS_STEP	16
+#define DL_AGGR_BUFFER_SIZE	SKB_MAX_ORDER(NET_SKB_PAD, 1)
 
 #ifndef A2_BAM_IRQ
 #define A2_BAM_IRQ -1
@@ -204,6 +213,21 @@ static unsigned long rx_timer_interval;
 static LIST_HEAD(bam_rx_pool);
 static DEFINE_MUTEX(bam_rx_pool_mutexlock);
 static int bam_rx_pool_len;
+/*
+ * Receive buffers that have been processed are parked on the recycle pool
+ * until every clone handed to a client has been freed, at which point the
+ * buffer is still DMA mapped and can be queued to the BAM again.
+ */
+static LIST_HEAD(bam_rx_recycle_pool);
+static int bam_rx_recycle_len;
+static int bam_rx_pool_target = NUM_BUFFERS;
+static uint32_t bam_rx_buffer_size = BUFFER_SIZE;
+static int bam_dl_aggregation;
+static uint32_t bam_rx_alloc_cnt;
+static uint32_t bam_rx_recycle_cnt;
+static uint32_t bam_rx_clone_fail_cnt;
+static uint32_t bam_rx_aggr_pkt_cnt;
+static uint32_t bam_rx_pool_grow_cnt;
 static LIST_HEAD(bam_tx_pool);
 static DEFINE_SPINLOCK(bam_tx_pool_spinlock);
 static DEFINE_MUTEX(bam_pdev_mutexlock);
@@ -231,6 +255,7 @@ static struct workqueue_struct *bam_mux_tx_workqueue;
 /* A2 power collaspe */
 #define UL_TIMEOUT_DELAY 1000	/* in ms */
 #define ENABLE_DISCONNECT_ACK	0x1
+#define ENABLE_DL_AGGREGATION	0x2
 static void toggle_apps_ack(void);
 static void reconnect_to_bam(void);
 static void disconnect_to_bam(void);
@@ -420,55 +445,179 @@ static inline void verify_tx_queue_is_empty(const char *func)
 	spin_unlock_irqrestore(&bam_tx_pool_spinlock, flags);
 }
 
-static void queue_rx(void)
+static void free_rx_buffer(struct rx_pkt_info *info)
+{
+	dma_unmap_single(NULL, info->dma_address, info->len, DMA_FROM_DEVICE);
+	dev_kfree_skb_any(info->skb);
+	kfree(info);
+}
+
+static struct rx_pkt_info *alloc_rx_buffer(void)
 {
 	void *ptr;
 	struct rx_pkt_info *info;
+
+	info = kmalloc(sizeof(struct rx_pkt_info), GFP_NOWAIT | __GFP_NOWARN);
+	if (!info) {
+		DMUX_LOG_KERR(
+		"%s: unable to alloc rx_pkt_info, will retry later\n",
+							__func__);
+		return NULL;
+	}
+
+	INIT_WORK(&info->work, handle_bam_mux_cmd);
+	info->len = bam_rx_buffer_size;
+
+	info->skb = __dev_alloc_skb(info->len, GFP_NOWAIT | __GFP_NOWARN);
+	if (info->skb == NULL) {
+		DMUX_LOG_KERR("%s: unable to alloc skb, will retry later\n",
+							__func__);
+		goto fail_info;
+	}
+	ptr = skb_put(info->skb, info->len);
+
+	info->dma_address = dma_map_single(NULL, ptr, info->len,
+						DMA_FROM_DEVICE);
+	if (info->dma_address == 0 || info->dma_address == ~0) {
+		DMUX_LOG_KERR("%s: dma_map_single failure %p for %p\n",
+			__func__, (void *)info->dma_address, ptr);
+		goto fail_skb;
+	}
+
+	++bam_rx_alloc_cnt;
+	return info;
+
+fail_skb:
+	dev_kfree_skb_any(info->skb);
+
+fail_info:
+	kfree(info);
+	return NULL;
+}
+
+/*
+ * Returns a buffer from the recycle pool once every clone handed to the
+ * clients has been released.  Buffers sized for a previous aggregation
+ * setting are freed instead of reused.
+ *
+ * Must be called with bam_rx_pool_mutexlock held.
+ */
+static struct rx_pkt_info *get_recycled_rx_buffer(void)
+{
+	struct rx_pkt_info *info, *n;
+
+	list_for_each_entry_safe(info, n, &bam_rx_recycle_pool, list_node) {
+		if (skb_cloned(info->skb))
+			continue;
+
+		list_del(&info->list_node);
+		--bam_rx_recycle_len;
+		if (info->len != bam_rx_buffer_size) {
+			free_rx_buffer(info);
+			continue;
+		}
+
+		/* no clones left, so the shared info is ours to reset */
+		memset(skb_shinfo(info->skb), 0,
+			offsetof(struct skb_shared_info, dataref));
+		++bam_rx_recycle_cnt;
+		return info;
+	}
+
+	return NULL;
+}
+
+/*
+ * Frees the oldest recycled buffers until at most max are left.  A buffer
+ * still referenced by a clone stays mapped and on the pool, it is freed
+ * by a later trim or reused once the clients release it.
+ *
+ * Must be called with bam_rx_pool_mutexlock held.
+ */
+static void trim_rx_recycle_pool(int max)
+{
+	struct rx_pkt_info *info, *n;
+
+	list_for_each_entry_safe(info, n, &bam_rx_recycle_pool, list_node) {
+		if (bam_rx_recycle_len <= max)
+			break;
+		if (skb_cloned(info->skb))
+			continue;
+
+		list_del(&info->list_node);
+		--bam_rx_recycle_len;
+		free_rx_buffer(info);
+	}
+}
+
+static void recycle_rx_buffer(struct rx_pkt_info *info)
+{
+	mutex_lock(&bam_rx_pool_mutexlock);
+	list_add_tail(&info->list_node, &bam_rx_recycle_pool);
+	++bam_rx_recycle_len;
+	trim_rx_recycle_pool(MAX_NUM_BUFFERS);
+	mutex_unlock(&bam_rx_pool_mutexlock);
+}
+
+static void grow_rx_pool(void)
+{
+	mutex_lock(&bam_rx_pool_mutexlock);
+	if (bam_rx_pool_target < MAX_NUM_BUFFERS) {
+		bam_rx_pool_target = min(bam_rx_pool_target + NUM_BUFFERS_STEP,
+						MAX_NUM_BUFFERS);
+		++bam_rx_pool_grow_cnt;
+		bam_dmux_log("%s: rx pool target %d\n", __func__,
+						bam_rx_pool_target);
+	}
+	mutex_unlock(&bam_rx_pool_mutexlock);
+}
+
+static void shrink_rx_pool(void)
+{
+	mutex_lock(&bam_rx_pool_mutexlock);
+	if (bam_rx_pool_target > NUM_BUFFERS) {
+		bam_rx_pool_target = max(bam_rx_pool_target - NUM_BUFFERS_STEP,
+						NUM_BUFFERS);
+		bam_dmux_log("%s: rx pool target %d\n", __func__,
+						bam_rx_pool_target);
+	}
+	mutex_unlock(&bam_rx_pool_mutexlock);
+}
+
+static void queue_rx(void)
+{
+	struct rx_pkt_info *info;
 	int ret;
 	int rx_len_cached;
+	int rx_target_cached;
 
 	mutex_lock(&bam_rx_pool_mutexlock);
 	rx_len_cached = bam_rx_pool_len;
+	rx_target_cached = bam_rx_pool_target;
 	mutex_unlock(&bam_rx_pool_mutexlock);
 
-	while (bam_connection_is_active && rx_len_cached < NUM_BUFFERS) {
+	while (bam_connection_is_active && rx_len_cached < rx_target_cached) {
 		if (in_global_reset)
 			goto fail;
 
-		info = kmalloc(sizeof(struct rx_pkt_info),
-						GFP_NOWAIT | __GFP_NOWARN);
-		if (!info) {
-			DMUX_LOG_KERR(
-			"%s: unable to alloc rx_pkt_info, will retry later\n",
-								__func__);
-			goto fail;
-		}
-
-		INIT_WORK(&info->work, handle_bam_mux_cmd);
-
-		info->skb = __dev_alloc_skb(BUFFER_SIZE,
-						GFP_NOWAIT | __GFP_NOWARN);
-		if (info->skb == NULL) {
-			DMUX_LOG_KERR(
-				"%s: unable to alloc skb, will retry later\n",
-								__func__);
-			goto fail_info;
-		}
-		ptr = skb_put(info->skb, BUFFER_SIZE);
+		mutex_lock(&bam_rx_pool_mutexlock);
+		info = get_recycled_rx_buffer();
+		mutex_unlock(&bam_rx_pool_mutexlock);
 
-		info->dma_address = dma_map_single(NULL, ptr, BUFFER_SIZE,
-							DMA_FROM_DEVICE);
-		if (info->dma_address == 0 || info->dma_address == ~0) {
-			DMUX_LOG_KERR("%s: dma_map_single failure %p for %p\n",
-				__func__, (void *)info->dma_address, ptr);
-			goto fail_skb;
-		}
+		if (info)
+			dma_sync_single_for_device(NULL, info->dma_address,
+						info->len, DMA_FROM_DEVICE);
+		else
+			info = alloc_rx_buffer();
+		if (!info)
+			goto fail;
 
 		mutex_lock(&bam_rx_pool_mutexlock);
 		list_add_tail(&info->list_node, &bam_rx_pool);
 		rx_len_cached = ++bam_rx_pool_len;
+		rx_target_cached = bam_rx_pool_target;
 		ret = sps_transfer_one(bam_rx_pipe, info->dma_address,
-			BUFFER_SIZE, info,
+			info->len, info,
 			SPS_IOVEC_FLAG_INT | SPS_IOVEC_FLAG_EOT);
 		if (ret) {
 			list_del(&info->list_node);
@@ -476,23 +625,14 @@ static void queue_rx(void)
 			mutex_unlock(&bam_rx_pool_mutexlock);
 			DMUX_LOG_KERR("%s: sps_transfer_one failed %d\n",
 				__func__, ret);
-
-			dma_unmap_single(NULL, info->dma_address, BUFFER_SIZE,
-						DMA_FROM_DEVICE);
-
-			goto fail_skb;
+			free_rx_buffer(info);
+			goto fail;
 		}
 		mutex_unlock(&bam_rx_pool_mutexlock);
 
 	}
 	return;
 
-fail_skb:
-	dev_kfree_skb_any(info->skb);
-
-fail_info:
-	kfree(info);
-
 fail:
 	if (rx_len_cached == 0) {
 		DMUX_LOG_KERR("%s: rescheduling\n", __func__);
@@ -505,18 +645,37 @@ static void queue_rx_work_func(struct work_struct *work)
 	queue_rx();
 }
 
-static void bam_mux_process_data(struct sk_buff *rx_skb)
+static void bam_mux_process_data(struct rx_pkt_info *info,
+					struct bam_mux_hdr *rx_hdr)
 {
 	unsigned long flags;
-	struct bam_mux_hdr *rx_hdr;
+	struct sk_buff *rx_skb;
 	unsigned long event_data;
+	uint32_t share;
 
-	rx_hdr = (struct bam_mux_hdr *)rx_skb->data;
+	/*
+	 * Hand the client a clone that points at this packet inside the
+	 * receive buffer, so the buffer can be recycled once it is freed.
+	 */
+	rx_skb = skb_clone(info->skb, GFP_NOWAIT | __GFP_NOWARN);
+	if (!rx_skb) {
+		++bam_rx_clone_fail_cnt;
+		return;
+	}
 
 	rx_skb->data = (unsigned char *)(rx_hdr + 1);
 	rx_skb->tail = rx_skb->data + rx_hdr->pkt_len;
 	rx_skb->len = rx_hdr->pkt_len;
-	rx_skb->truesize = rx_hdr->pkt_len + sizeof(struct sk_buff);
+
+	/*
+	 * A single frame pins the whole buffer, aggregated frames split it
+	 * between their clones.
+	 */
+	share = info->len;
+	if (bam_dl_aggregation)
+		share = min_t(uint32_t, share, sizeof(struct bam_mux_hdr) +
+				rx_hdr->pkt_len + rx_hdr->pad_len);
+	rx_skb->truesize = share + sizeof(struct sk_buff);
 
 	event_data = (unsigned long)(rx_skb);
 
@@ -528,8 +687,18 @@ static void bam_mux_process_data(struct sk_buff *rx_skb)
 	else
 		dev_kfree_skb_any(rx_skb);
 	spin_unlock_irqrestore(&bam_ch[rx_hdr->ch_id].lock, flags);
+}
 
-	queue_rx();
+static void enable_dl_aggregation(void)
+{
+	if (!bam_dl_aggregation_enabled || bam_dl_aggregation)
+		return;
+
+	bam_dmux_log("%s: downlink aggregation enabled\n", __func__);
+	mutex_lock(&bam_rx_pool_mutexlock);
+	bam_rx_buffer_size = DL_AGGR_BUFFER_SIZE;
+	bam_dl_aggregation = 1;
+	mutex_unlock(&bam_rx_pool_mutexlock);
 }
 
 static inline void handle_bam_mux_cmd_open(struct bam_mux_hdr *rx_hdr)
@@ -542,7 +711,6 @@ static inline void handle_bam_mux_cmd_open(struct bam_mux_hdr *rx_hdr)
 		bam_dmux_log("%s: open cid %d aborted due to ssr\n",
 				__func__, rx_hdr->ch_id);
 		mutex_unlock(&bam_pdev_mutexlock);
-		queue_rx();
 		return;
 	}
 	spin_lock_irqsave(&bam_ch[rx_hdr->ch_id].lock, flags);
@@ -554,22 +722,12 @@ static inline void handle_bam_mux_cmd_open(struct bam_mux_hdr *rx_hdr)
 		pr_err("%s: platform_device_add() error: %d\n",
 				__func__, ret);
 	mutex_unlock(&bam_pdev_mutexlock);
-	queue_rx();
 }
 
-static void handle_bam_mux_cmd(struct work_struct *work)
+static int handle_bam_mux_frame(struct rx_pkt_info *info,
+					struct bam_mux_hdr *rx_hdr)
 {
 	unsigned long flags;
-	struct bam_mux_hdr *rx_hdr;
-	struct rx_pkt_info *info;
-	struct sk_buff *rx_skb;
-
-	info = container_of(work, struct rx_pkt_info, work);
-	rx_skb = info->skb;
-	dma_unmap_single(NULL, info->dma_address, BUFFER_SIZE, DMA_FROM_DEVICE);
-	kfree(info);
-
-	rx_hdr = (struct bam_mux_hdr *)rx_skb->data;
 
 	DBG_INC_READ_CNT(sizeof(struct bam_mux_hdr));
 	DBG("%s: magic %x reserved %d cmd %d pad %d ch %d len %d\n", __func__,
@@ -581,9 +739,7 @@ static void handle_bam_mux_cmd(struct work_struct *work)
 			" pad %d ch %d len %d\n", __func__,
 			rx_hdr->magic_num, rx_hdr->reserved, rx_hdr->cmd,
 			rx_hdr->pad_len, rx_hdr->ch_id, rx_hdr->pkt_len);
-		dev_kfree_skb_any(rx_skb);
-		queue_rx();
-		return;
+		return -EINVAL;
 	}
 
 	if (rx_hdr->ch_id >= BAM_DMUX_NUM_CHANNELS) {
@@ -592,26 +748,25 @@ static void handle_bam_mux_cmd(struct work_struct *work)
 			" pad %d ch %d len %d\n", __func__,
 			rx_hdr->ch_id, rx_hdr->reserved, rx_hdr->cmd,
 			rx_hdr->pad_len, rx_hdr->ch_id, rx_hdr->pkt_len);
-		dev_kfree_skb_any(rx_skb);
-		queue_rx();
-		return;
+		return -EINVAL;
 	}
 
 	switch (rx_hdr->cmd) {
 	case BAM_MUX_HDR_CMD_DATA:
 		DBG_INC_READ_CNT(rx_hdr->pkt_len);
-		bam_mux_process_data(rx_skb);
+		bam_mux_process_data(info, rx_hdr);
 		break;
 	case BAM_MUX_HDR_CMD_OPEN:
 		bam_dmux_log("%s: opening cid %d PC enabled\n", __func__,
 				rx_hdr->ch_id);
+		if (rx_hdr->reserved & ENABLE_DL_AGGREGATION)
+			enable_dl_aggregation();
 		handle_bam_mux_cmd_open(rx_hdr);
 		if (!(rx_hdr->reserved & ENABLE_DISCONNECT_ACK)) {
 			bam_dmux_log("%s: deactivating disconnect ack\n",
 								__func__);
 			disconnect_ack = 0;
 		}
-		dev_kfree_skb_any(rx_skb);
 		break;
 	case BAM_MUX_HDR_CMD_OPEN_NO_A2_PC:
 		bam_dmux_log("%s: opening cid %d PC disabled\n", __func__,
@@ -622,8 +777,9 @@ static void handle_bam_mux_cmd(struct work_struct *work)
 			ul_wakeup();
 		}
 
+		if (rx_hdr->reserved & ENABLE_DL_AGGREGATION)
+			enable_dl_aggregation();
 		handle_bam_mux_cmd_open(rx_hdr);
-		dev_kfree_skb_any(rx_skb);
 		break;
 	case BAM_MUX_HDR_CMD_CLOSE:
 		/* probably should drop pending write */
@@ -645,8 +801,6 @@ static void handle_bam_mux_cmd(struct work_struct *work)
 		if (!bam_ch[rx_hdr->ch_id].pdev)
 			pr_err("%s: platform_device_alloc failed\n", __func__);
 		mutex_unlock(&bam_pdev_mutexlock);
-		dev_kfree_skb_any(rx_skb);
-		queue_rx();
 		break;
 	default:
 		DMUX_LOG_KERR("%s: dropping invalid hdr. magic %x"
@@ -654,10 +808,50 @@ static void handle_bam_mux_cmd(struct work_struct *work)
 			__func__, rx_hdr->magic_num, rx_hdr->reserved,
 			rx_hdr->cmd, rx_hdr->pad_len, rx_hdr->ch_id,
 			rx_hdr->pkt_len);
-		dev_kfree_skb_any(rx_skb);
-		queue_rx();
-		return;
+		return -EINVAL;
 	}
+
+	return 0;
+}
+
+static void handle_bam_mux_cmd(struct work_struct *work)
+{
+	struct rx_pkt_info *info;
+	struct bam_mux_hdr *rx_hdr;
+	uint32_t offset = 0;
+	uint32_t frame_len;
+
+	info = container_of(work, struct rx_pkt_info, work);
+	dma_sync_single_for_cpu(NULL, info->dma_address, info->len,
+							DMA_FROM_DEVICE);
+
+	/*
+	 * Without downlink aggregation every descriptor holds one frame.
+	 * With it the A2 packs as many padded frames as fit and reports
+	 * the number of bytes written in the iovec.
+	 */
+	if (info->sps_size > info->len)
+		info->sps_size = info->len;
+
+	do {
+		rx_hdr = (struct bam_mux_hdr *)(info->skb->data + offset);
+		frame_len = sizeof(struct bam_mux_hdr) + rx_hdr->pkt_len;
+		if (offset + frame_len > info->len) {
+			DMUX_LOG_KERR("%s: dropping oversized frame len %d"
+				" at offset %d\n", __func__,
+				rx_hdr->pkt_len, offset);
+			break;
+		}
+		if (offset)
+			++bam_rx_aggr_pkt_cnt;
+		if (handle_bam_mux_frame(info, rx_hdr))
+			break;
+		offset += frame_len + rx_hdr->pad_len;
+	} while (bam_dl_aggregation &&
+		offset + sizeof(struct bam_mux_hdr) <= info->sps_size);
+
+	recycle_rx_buffer(info);
+	queue_rx();
 }
 
 static int bam_mux_write_cmd(void *data, uint32_t len)
@@ -955,7 +1149,7 @@ int msm_bam_dmux_open(uint32_t id, void *priv,
 
 	hdr->magic_num = BAM_MUX_HDR_MAGIC_NO;
 	hdr->cmd = BAM_MUX_HDR_CMD_OPEN;
-	hdr->reserved = 0;
+	hdr->reserved = bam_dl_aggregation ? ENABLE_DL_AGGREGATION : 0;
 	hdr->ch_id = id;
 	hdr->pkt_len = 0;
 	hdr->pad_len = 0;
@@ -1136,6 +1330,7 @@ static void rx_switch_to_interrupt_mode(void)
 		list_del(&info->list_node);
 		--bam_rx_pool_len;
 		mutex_unlock(&bam_rx_pool_mutexlock);
+		info->sps_size = iov.size;
 		handle_bam_mux_cmd(&info->work);
 	}
 	return;
@@ -1151,7 +1346,7 @@ static void rx_timer_work_func(struct work_struct *work)
 	struct rx_pkt_info *info;
 	int inactive_cycles = 0;
 	int ret;
-	u32 buffs_unused, buffs_used;
+	u32 buffs_unused, buffs_used, buffs_posted;
 
 	while (bam_connection_is_active) { /* timer loop */
 		++inactive_cycles;
@@ -1195,10 +1390,12 @@ static void rx_timer_work_func(struct work_struct *work)
 			list_del(&info->list_node);
 			--bam_rx_pool_len;
 			mutex_unlock(&bam_rx_pool_mutexlock);
+			info->sps_size = iov.size;
 			handle_bam_mux_cmd(&info->work);
 		}
 
 		if (inactive_cycles >= POLLING_INACTIVITY) {
+			shrink_rx_pool();
 			rx_switch_to_interrupt_mode();
 			break;
 		}
@@ -1216,14 +1413,18 @@ static void rx_timer_work_func(struct work_struct *work)
 				break;
 			}
 
-			buffs_used = NUM_BUFFERS - buffs_unused;
+			buffs_posted = bam_rx_pool_len;
+			buffs_used = buffs_posted > buffs_unused ?
+					buffs_posted - buffs_unused : 0;
 
 			if (buffs_unused == 0) {
+				/* the ring drained while we slept */
 				rx_timer_interval = MIN_POLLING_SLEEP;
+				grow_rx_pool();
 			} else {
 				if (buffs_used > 0) {
 					rx_timer_interval =
-						(2 * NUM_BUFFERS *
+						(2 * buffs_posted *
 							rx_timer_interval)/
 						(3 * buffs_used);
 				} else {
@@ -1359,7 +1560,16 @@ static int debug_stats(char *buf, int max)
 			"rx queue len:    %d\n"
 			"a2 ack out cnt:  %d\n"
 			"a2 ack in cnt:   %d\n"
-			"a2 pwr cntl in:  %d\n",
+			"a2 pwr cntl in:  %d\n"
+			"rx pool target:  %d\n"
+			"rx recycle len:  %d\n"
+			"rx buffer size:  %u\n"
+			"rx dl aggr:      %d\n"
+			"rx buf allocs:   %u\n"
+			"rx buf recycled: %u\n"
+			"rx pool grows:   %u\n"
+			"rx aggr pkts:    %u\n"
+			"rx clone fails:  %u\n",
 			bam_dmux_read_cnt,
 			bam_dmux_write_cnt,
 			bam_dmux_write_cpy_cnt,
@@ -1369,7 +1579,16 @@ static int debug_stats(char *buf, int max)
 			bam_rx_pool_len,
 			atomic_read(&bam_dmux_ack_out_cnt),
 			atomic_read(&bam_dmux_ack_in_cnt),
-			atomic_read(&bam_dmux_a2_pwr_cntl_in_cnt)
+			atomic_read(&bam_dmux_a2_pwr_cntl_in_cnt),
+			bam_rx_pool_target,
+			bam_rx_recycle_len,
+			bam_rx_buffer_size,
+			bam_dl_aggregation,
+			bam_rx_alloc_cnt,
+			bam_rx_recycle_cnt,
+			bam_rx_pool_grow_cnt,
+			bam_rx_aggr_pkt_cnt,
+			bam_rx_clone_fail_cnt
 			);
 
 	return i;
@@ -1860,8 +2079,6 @@ static void reconnect_to_bam(void)
 
 static void disconnect_to_bam(void)
 {
-	struct list_head *node;
-	struct rx_pkt_info *info;
 	unsigned long flags;
 
 	bam_connection_is_active = 0;
@@ -1879,17 +2096,16 @@ static void disconnect_to_bam(void)
 	INIT_COMPLETION(bam_connection_completion);
 	unvote_dfab();
 
+	/*
+	 * Buffers that were queued to the BAM are still mapped and unused,
+	 * keep a minimal pool of them around for the next connection.
+	 */
 	mutex_lock(&bam_rx_pool_mutexlock);
-	while (!list_empty(&bam_rx_pool)) {
-		node = bam_rx_pool.next;
-		list_del(node);
-		info = container_of(node, struct rx_pkt_info, list_node);
-		dma_unmap_single(NULL, info->dma_address, BUFFER_SIZE,
-							DMA_FROM_DEVICE);
-		dev_kfree_skb_any(info->skb);
-		kfree(info);
-	}
+	list_splice_tail_init(&bam_rx_pool, &bam_rx_recycle_pool);
+	bam_rx_recycle_len += bam_rx_pool_len;
 	bam_rx_pool_len = 0;
+	trim_rx_recycle_pool(NUM_BUFFERS);
+	bam_rx_pool_target = NUM_BUFFERS;
 	mutex_unlock(&bam_rx_pool_mutexlock);
 
 	if (disconnect_ack)
@@ -2008,6 +2224,8 @@ static int restart_notifier_cb(struct notifier_block *this,
 	a2_pc_disabled = 0;
 	a2_pc_disabled_wakelock_skipped = 0;
 	disconnect_ack = 1;
+	bam_dl_aggregation = 0;
+	bam_rx_buffer_size = BUFFER_SIZE;
 
 	/* Cleanup Channel States */
 	mutex_lock(&bam_pdev_mutexlock);
@@ -0,0 +1,330 @@
+/* Copyright (c) 2012, Code Aurora Forum. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+/*
+ * Prediction based cpuidle governor for MSM low power modes.
+ *
+ * The timer based sleep length alone is a poor guess on a phone: touch,
+ * modem and USB interrupts end most idle periods long before the next
+ * timer. For every cpu we keep the last few residencies and count
+ * whether each wakeup came from the timer or from something else. When
+ * the recent residencies are close to each other their average is used
+ * as the expected idle time, otherwise the timer is trusted.
+ *
+ * The round trip cost of each mode is measured too, starting from the
+ * platform latency: the shortest early wakeup seen for a mode is what it
+ * costs to enter and leave it. A mode is only picked when the predicted
+ * idle time covers the break-even point derived from that cost, and
+ * neither is ever below what the platform data says.
+ */
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/init.h>
+#include <linux/cpuidle.h>
+#include <linux/debugfs.h>
+#include <linux/percpu.h>
+#include <linux/seq_file.h>
+
+#include "pm.h"
+
+#define MSM_IDLE_PREDICT_HISTORY	8
+/* A wakeup within this much of the timer counts as a timer wakeup */
+#define MSM_IDLE_PREDICT_TIMER_SLACK_US	50
+/* Residencies longer than this many times the cost say nothing about it */
+#define MSM_IDLE_PREDICT_COST_WINDOW	2
+
+struct msm_idle_predict_state {
+	uint32_t cost_us;	/* shortest early wakeup seen, slowly aged */
+	uint32_t too_deep;	/* woke before the break-even point */
+	uint32_t too_shallow;	/* a deeper allowed mode would have paid */
+	uint32_t entered;
+};
+
+struct msm_idle_predict_cpu {
+	uint32_t history[MSM_IDLE_PREDICT_HISTORY];
+	int history_idx;
+
+	uint32_t timer_us;	/* sleep length from the tick code */
+	uint32_t predicted_us;
+	uint32_t latency_us;
+
+	uint32_t predictions;
+	uint32_t timer_wakes;
+	uint32_t irq_wakes;
+
+	struct msm_idle_predict_state states[CPUIDLE_STATE_MAX];
+};
+
+static DEFINE_PER_CPU_SHARED_ALIGNED(struct msm_idle_predict_cpu,
+		msm_idle_predict_data);
+
+static bool msm_idle_predict_enabled = true;
+module_param_named(
+	enabled, msm_idle_predict_enabled, bool, S_IRUGO | S_IWUSR | S_IWGRP
+);
+
+/* The break-even residency of a mode is this many times its cost */
+static unsigned int msm_idle_predict_cost_mult = 2;
+module_param_named(
+	cost_mult, msm_idle_predict_cost_mult, uint, S_IRUGO | S_IWUSR | S_IWGRP
+);
+
+/*
+ * Average of the recent residencies if they are consistent enough to be
+ * trusted, 0 otherwise. Outliers above the average are dropped one at a
+ * time, the same way the menu governor looks for a repeating pattern.
+ */
+static uint32_t msm_idle_predict_typical(struct msm_idle_predict_cpu *data)
+{
+	uint32_t max, thresh = UINT_MAX;
+	uint64_t avg, stddev;
+	int i, divisor;
+
+	do {
+		avg = 0;
+		max = 0;
+		divisor = 0;
+		for (i = 0; i < MSM_IDLE_PREDICT_HISTORY; i++) {
+			uint32_t value = data->history[i];
+
+			if (!value || value > thresh)
+				continue;
+			avg += value;
+			divisor++;
+			if (value > max)
+				max = value;
+		}
+		if (divisor < MSM_IDLE_PREDICT_HISTORY / 2)
+			return 0;
+		do_div(avg, divisor);
+
+		stddev = 0;
+		for (i = 0; i < MSM_IDLE_PREDICT_HISTORY; i++) {
+			uint32_t value = data->history[i];
+			int64_t diff;
+
+			if (!value || value > thresh)
+				continue;
+			diff = (int64_t)value - (int64_t)avg;
+			stddev += diff * diff;
+		}
+		do_div(stddev, divisor);
+
+		/* Within ~17% of the average, or within 20us */
+		if (avg * avg > 36 * stddev || stddev <= 400)
+			return (uint32_t)avg;
+
+		thresh = max - 1;
+	} while (divisor > MSM_IDLE_PREDICT_HISTORY / 2);
+
+	return 0;
+}
+
+/*
+ * Called from msm_pm_idle_prepare() with the timer sleep length. Returns
+ * the sleep length to plan for, which is never longer than the timer.
+ */
+uint32_t msm_idle_predict(struct cpuidle_device *dev, uint32_t latency_us,
+		uint32_t timer_us)
+{
+	struct msm_idle_predict_cpu *data =
+		&per_cpu(msm_idle_predict_data, dev->cpu);
+	uint32_t typical;
+
+	data->timer_us = timer_us;
+	data->latency_us = latency_us;
+	data->predicted_us = timer_us;
+
+	if (!msm_idle_predict_enabled)
+		return timer_us;
+
+	typical = msm_idle_predict_typical(data);
+	if (typical && typical < timer_us)
+		data->predicted_us = typical;
+
+	data->predictions++;
+	return data->predicted_us;
+}
+
+/*
+ * Fill in the exit latency and break-even residency of a state: the
+ * platform values, raised to the measured cost when it is higher. The
+ * cost is seeded from the platform latency.
+ */
+void msm_idle_predict_state_cost(struct cpuidle_device *dev, int idx,
+		uint32_t platform_latency_us, uint32_t platform_residency_us,
+		uint32_t *latency_us, uint32_t *residency_us)
+{
+	struct msm_idle_predict_cpu *data =
+		&per_cpu(msm_idle_predict_data, dev->cpu);
+	struct msm_idle_predict_state *st = &data->states[idx];
+
+	if (!msm_idle_predict_enabled)
+		return;
+
+	if (!st->cost_us)
+		st->cost_us = platform_latency_us;
+
+	*latency_us = max(platform_latency_us, st->cost_us);
+	*residency_us = max(platform_residency_us,
+			st->cost_us * msm_idle_predict_cost_mult);
+}
+
+static int msm_idle_predict_select(struct cpuidle_device *dev)
+{
+	struct msm_idle_predict_cpu *data =
+		&per_cpu(msm_idle_predict_data, dev->cpu);
+	int i, idx = 0;
+
+	for (i = 0; i < dev->state_count; i++) {
+		struct cpuidle_state *s = &dev->states[i];
+
+		if (s->flags & CPUIDLE_FLAG_IGNORE)
+			continue;
+		if (s->target_residency > data->predicted_us)
+			continue;
+		if (s->exit_latency > data->latency_us)
+			continue;
+		idx = i;
+	}
+
+	return idx;
+}
+
+static void msm_idle_predict_reflect(struct cpuidle_device *dev)
+{
+	struct msm_idle_predict_cpu *data =
+		&per_cpu(msm_idle_predict_data, dev->cpu);
+	struct msm_idle_predict_state *st;
+	uint32_t residency = (uint32_t)cpuidle_get_last_residency(dev);
+	bool timer_wake;
+	int idx;
+	int i;
+
+	if (!dev->last_state)
+		return;
+	idx = dev->last_state - dev->states;
+	if (idx < 0 || idx >= dev->state_count)
+		return;
+	st = &data->states[idx];
+	st->entered++;
+
+	timer_wake = residency + MSM_IDLE_PREDICT_TIMER_SLACK_US >=
+			data->timer_us;
+	if (timer_wake)
+		data->timer_wakes++;
+	else
+		data->irq_wakes++;
+
+	/*
+	 * Track the cheapest round trip. Short residencies just above it
+	 * pull it up a little, so that a stale minimum (e.g. measured at a
+	 * higher cpu clock) does not stick forever. Timer wakeups and long
+	 * sleeps say nothing about the cost and are ignored.
+	 */
+	if (st->cost_us && !timer_wake) {
+		if (residency < st->cost_us)
+			st->cost_us = residency;
+		else if (residency < MSM_IDLE_PREDICT_COST_WINDOW *
+				st->cost_us)
+			st->cost_us += (residency - st->cost_us) >> 3;
+	}
+
+	data->history[data->history_idx] = residency ? residency : 1;
+	data->history_idx = (data->history_idx + 1) % MSM_IDLE_PREDICT_HISTORY;
+
+	if (residency < dev->last_state->target_residency) {
+		st->too_deep++;
+		return;
+	}
+	for (i = idx + 1; i < dev->state_count; i++) {
+		struct cpuidle_state *s = &dev->states[i];
+
+		if (s->flags & CPUIDLE_FLAG_IGNORE)
+			continue;
+		if (s->exit_latency <= data->latency_us &&
+				s->target_residency <= residency) {
+			st->too_shallow++;
+			break;
+		}
+	}
+}
+
+static struct cpuidle_governor msm_idle_predict_governor = {
+	.name =		"msm_predict",
+	.rating =	30,
+	.select =	msm_idle_predict_select,
+	.reflect =	msm_idle_predict_reflect,
+	.owner =	THIS_MODULE,
+};
+
+static int msm_idle_predict_stats_show(struct seq_file *m, void *unused)
+{
+	unsigned int cpu;
+	int i;
+
+	for_each_possible_cpu(cpu) {
+		struct msm_idle_predict_cpu *data =
+			&per_cpu(msm_idle_predict_data, cpu);
+		struct cpuidle_device *dev = per_cpu(cpuidle_devices, cpu);
+
+		seq_printf(m, "CPU%u: predictions %u timer_wakes %u "
+			"irq_wakes %u last_predicted %uus\n",
+			cpu, data->predictions, data->timer_wakes,
+			data->irq_wakes, data->predicted_us);
+
+		if (!dev)
+			continue;
+
+		for (i = 0; i < dev->state_count; i++) {
+			struct msm_idle_predict_state *st = &data->states[i];
+
+			seq_printf(m, "  %-26s entered %u cost %uus "
+				"too_deep %u too_shallow %u\n",
+				dev->states[i].desc, st->entered, st->cost_us,
+				st->too_deep, st->too_shallow);
+		}
+	}
+
+	return 0;
+}
+
+static int msm_idle_predict_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, msm_idle_predict_stats_show, NULL);
+}
+
+static const struct file_operations msm_idle_predict_stats_fops = {
+	.open = msm_idle_predict_stats_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+static int __init msm_idle_predict_init(void)
+{
+	int ret;
+
+	ret = cpuidle_register_governor(&msm_idle_predict_governor);
+	if (ret) {
+		pr_err("%s: failed to register governor: %d\n", __func__, ret);
+		return ret;
+	}
+
+	debugfs_create_file("msm_idle_predict", S_IRUGO, NULL, NULL,
+			&msm_idle_predict_stats_fops);
+	return 0;
+}
+
+late_initcall(msm_idle_predict_init);
@@ -34,14 +34,24 @@ struct msm_rtb_platform_data {
 };
 
 #if defined(CONFIG_MSM_RTB)
+/* Event types currently logged, 0 while RTB is disabled */
+extern unsigned int msm_rtb_log_mask;
+
+static inline int msm_rtb_type_enabled(enum logk_event_type log_type)
+{
+	return msm_rtb_log_mask & (1 << (log_type & ~LOGTYPE_NOPC));
+}
+
 /*
- * returns 1 if data was logged, 0 otherwise
+ * returns 1 if data was logged to the uncached buffer and the caller
+ * should order its access after it, 0 otherwise
  */
 int uncached_logk_pc(enum logk_event_type log_type, void *caller,
 				void *data);
 
 /*
- * returns 1 if data was logged, 0 otherwise
+ * returns 1 if data was logged to the uncached buffer and the caller
+ * should order its access after it, 0 otherwise
  */
 int uncached_logk(enum logk_event_type log_type, void *data);
 
@@ -63,6 +73,9 @@ int uncached_logk(enum logk_event_type log_type, void *data);
 			 } while (0)
 #else
 
+static inline int msm_rtb_type_enabled(enum logk_event_type log_type)
+{ return 0; }
+
 static inline int uncached_logk_pc(enum logk_event_type log_type,
 					void *caller,
 					void *data) { return 0; }
@@ -21,7 +21,9 @@
 #include <linux/slab.h>
 #include <linux/string.h>
 #include <linux/atomic.h>
+#include <asm/cacheflush.h>
 #include <asm/io.h>
+#include <asm/outercache.h>
 #include <asm-generic/sizes.h>
 #include <mach/memory.h>
 #include <mach/msm_rtb.h>
@@ -39,6 +41,12 @@
  * 4) 4 bytes extra data from the caller
  *
  * Total = 16 bytes.
+ *
+ * With CONFIG_MSM_RTB_SEPARATE_CPUS the buffer is split into one
+ * contiguous segment per possible cpu, in cpu order, and the index is a
+ * sequence number private to that cpu. A timestamp entry is written at
+ * the start of every MSM_RTB_TIMESTAMP_INTERVAL entries of a segment so
+ * the segments can be merged back in time order from a RAM dump.
  */
 struct msm_rtb_layout {
 	unsigned char sentinel[3];
@@ -49,15 +57,17 @@ struct msm_rtb_layout {
 } __attribute__ ((__packed__));
 
 
+#define MSM_RTB_TIMESTAMP_INTERVAL	256
+
 struct msm_rtb_state {
 	struct msm_rtb_layout *rtb;
 	unsigned long phys;
-	int nentries;
+	int nentries;		/* per segment */
 	int size;
 	int enabled;
 	int initialized;
 	uint32_t filter;
-	int step_size;
+	unsigned long timestamp_mask;
 };
 
 #if defined(CONFIG_MSM_RTB_SEPARATE_CPUS)
@@ -71,13 +81,60 @@ struct msm_rtb_state msm_rtb = {
 	.enabled = 1,
 };
 
-module_param_named(filter, msm_rtb.filter, uint, 0644);
-module_param_named(enable, msm_rtb.enabled, int, 0644);
+/*
+ * The filter as seen by the logging fast path: 0 whenever RTB is not
+ * initialized or disabled, so a single load decides whether to log.
+ */
+unsigned int msm_rtb_log_mask;
+EXPORT_SYMBOL(msm_rtb_log_mask);
+
+static void msm_rtb_update_log_mask(void)
+{
+	msm_rtb_log_mask = (msm_rtb.initialized && msm_rtb.enabled) ?
+				msm_rtb.filter : 0;
+}
+
+static int msm_rtb_set_filter(const char *val, const struct kernel_param *kp)
+{
+	int ret = param_set_uint(val, kp);
+
+	if (!ret)
+		msm_rtb_update_log_mask();
+	return ret;
+}
+
+static int msm_rtb_set_enable(const char *val, const struct kernel_param *kp)
+{
+	int ret = param_set_int(val, kp);
+
+	if (!ret)
+		msm_rtb_update_log_mask();
+	return ret;
+}
+
+static struct kernel_param_ops msm_rtb_filter_ops = {
+	.set = msm_rtb_set_filter,
+	.get = param_get_uint,
+};
+
+static struct kernel_param_ops msm_rtb_enable_ops = {
+	.set = msm_rtb_set_enable,
+	.get = param_get_int,
+};
+
+module_param_cb(filter, &msm_rtb_filter_ops, &msm_rtb.filter, 0644);
+module_param_cb(enable, &msm_rtb_enable_ops, &msm_rtb.enabled, 0644);
 
 static int msm_rtb_panic_notifier(struct notifier_block *this,
 					unsigned long event, void *ptr)
 {
 	msm_rtb.enabled = 0;
+	msm_rtb_update_log_mask();
+#if defined(CONFIG_MSM_RTB_CACHED)
+	/* Make sure the log is in memory for the RAM dump */
+	flush_cache_all();
+	outer_flush_all();
+#endif
 	return NOTIFY_DONE;
 }
 
@@ -87,8 +144,7 @@ static struct notifier_block msm_rtb_panic_blk = {
 
 int msm_rtb_event_should_log(enum logk_event_type log_type)
 {
-	return msm_rtb.initialized && msm_rtb.enabled &&
-		((1 << (log_type & ~LOGTYPE_NOPC)) & msm_rtb.filter);
+	return msm_rtb_type_enabled(log_type);
 }
 EXPORT_SYMBOL(msm_rtb_event_should_log);
 
@@ -122,23 +178,26 @@ static void msm_rtb_write_data(void *data, struct msm_rtb_layout *start)
 }
 
 static void uncached_logk_pc_idx(enum logk_event_type log_type, void *caller,
-				 void *data, int idx)
+				 void *data, int seg, int idx)
 {
 	struct msm_rtb_layout *start;
 
-	start = &msm_rtb.rtb[idx & (msm_rtb.nentries - 1)];
+	start = &msm_rtb.rtb[seg * msm_rtb.nentries +
+			     (idx & (msm_rtb.nentries - 1))];
 
 	msm_rtb_emit_sentinel(start);
 	msm_rtb_write_type(log_type, start);
 	msm_rtb_write_caller(caller, start);
 	msm_rtb_write_idx(idx, start);
 	msm_rtb_write_data(data, start);
+#if !defined(CONFIG_MSM_RTB_CACHED)
 	mb();
+#endif
 
 	return;
 }
 
-static void uncached_logk_timestamp(int idx)
+static void uncached_logk_timestamp(int seg, int idx)
 {
 	unsigned long long timestamp;
 	void *timestamp_upper, *timestamp_lower;
@@ -147,71 +206,58 @@ static void uncached_logk_timestamp(int idx)
 	timestamp_upper = (void *)upper_32_bits(timestamp);
 
 	uncached_logk_pc_idx(LOGK_TIMESTAMP|LOGTYPE_NOPC, timestamp_lower,
-			     timestamp_upper, idx);
+			     timestamp_upper, seg, idx);
 }
 
-#if defined(CONFIG_MSM_RTB_SEPARATE_CPUS)
-static int msm_rtb_get_idx(void)
+static int msm_rtb_get_idx(int *seg)
 {
-	int cpu, i, offset;
 	atomic_t *index;
+	int i;
 
+#if defined(CONFIG_MSM_RTB_SEPARATE_CPUS)
 	/*
 	 * ideally we would use get_cpu but this is a close enough
-	 * approximation for our purposes.
+	 * approximation for our purposes: the index is still atomic, so a
+	 * migrated writer only ever lands in another cpu's free slot.
 	 */
-	cpu = raw_smp_processor_id();
-
-	index = &per_cpu(msm_rtb_idx_cpu, cpu);
-
-	i = atomic_add_return(msm_rtb.step_size, index);
-	i -= msm_rtb.step_size;
-
-	/* Check if index has wrapped around */
-	offset = (i & (msm_rtb.nentries - 1)) -
-		 ((i - msm_rtb.step_size) & (msm_rtb.nentries - 1));
-	if (offset < 0) {
-		uncached_logk_timestamp(i);
-		i = atomic_add_return(msm_rtb.step_size, index);
-		i -= msm_rtb.step_size;
-	}
-
-	return i;
-}
+	*seg = raw_smp_processor_id();
+	index = &per_cpu(msm_rtb_idx_cpu, *seg);
 #else
-static int msm_rtb_get_idx(void)
-{
-	int i, offset;
+	*seg = 0;
+	index = &msm_rtb_idx;
+#endif
 
-	i = atomic_inc_return(&msm_rtb_idx);
+	i = atomic_inc_return(index);
 	i--;
 
-	/* Check if index has wrapped around */
-	offset = (i & (msm_rtb.nentries - 1)) -
-		 ((i - 1) & (msm_rtb.nentries - 1));
-	if (offset < 0) {
-		uncached_logk_timestamp(i);
-		i = atomic_inc_return(&msm_rtb_idx);
+	/* Start of a stretch, including the wrap around: timestamp it */
+	if (!(i & msm_rtb.timestamp_mask)) {
+		uncached_logk_timestamp(*seg, i);
+		i = atomic_inc_return(index);
 		i--;
 	}
 
 	return i;
 }
-#endif
 
 int uncached_logk_pc(enum logk_event_type log_type, void *caller,
 				void *data)
 {
-	int i;
+	int i, seg;
 
 	if (!msm_rtb_event_should_log(log_type))
 		return 0;
 
-	i = msm_rtb_get_idx();
+	i = msm_rtb_get_idx(&seg);
 
-	uncached_logk_pc_idx(log_type, caller, data, i);
+	uncached_logk_pc_idx(log_type, caller, data, seg, i);
 
+#if defined(CONFIG_MSM_RTB_CACHED)
+	/* Nothing for the caller to order against */
+	return 0;
+#else
 	return 1;
+#endif
 }
 EXPORT_SYMBOL(uncached_logk_pc);
 
@@ -243,7 +289,11 @@ int msm_rtb_probe(struct platform_device *pdev)
 	if (!msm_rtb.phys)
 		return -ENOMEM;
 
+#if defined(CONFIG_MSM_RTB_CACHED)
+	msm_rtb.rtb = ioremap_cached(msm_rtb.phys, msm_rtb.size);
+#else
 	msm_rtb.rtb = ioremap(msm_rtb.phys, msm_rtb.size);
+#endif
 
 	if (!msm_rtb.rtb) {
 		free_contiguous_memory_by_paddr(msm_rtb.phys);
@@ -251,9 +301,14 @@ int msm_rtb_probe(struct platform_device *pdev)
 	}
 
 	msm_rtb.nentries = msm_rtb.size / sizeof(struct msm_rtb_layout);
+#if defined(CONFIG_MSM_RTB_SEPARATE_CPUS)
+	msm_rtb.nentries /= num_possible_cpus();
+#endif
 
 	/* Round this down to a power of 2 */
 	msm_rtb.nentries = __rounddown_pow_of_two(msm_rtb.nentries);
+	msm_rtb.timestamp_mask = min(msm_rtb.nentries,
+				     MSM_RTB_TIMESTAMP_INTERVAL) - 1;
 
 	memset(msm_rtb.rtb, 0, msm_rtb.size);
 
@@ -261,17 +316,16 @@ int msm_rtb_probe(struct platform_device *pdev)
 #if defined(CONFIG_MSM_RTB_SEPARATE_CPUS)
 	for_each_possible_cpu(cpu) {
 		atomic_t *a = &per_cpu(msm_rtb_idx_cpu, cpu);
-		atomic_set(a, cpu);
+		atomic_set(a, 0);
 	}
-	msm_rtb.step_size = num_possible_cpus();
 #else
 	atomic_set(&msm_rtb_idx, 0);
-	msm_rtb.step_size = 1;
 #endif
 
 	atomic_notifier_chain_register(&panic_notifier_list,
 						&msm_rtb_panic_blk);
 	msm_rtb.initialized = 1;
+	msm_rtb_update_log_mask();
 	return 0;
 }
 
@@ -694,6 +694,7 @@ int msm_pm_idle_prepare(struct cpuidle_device *dev)
 	latency_us = (uint32_t) pm_qos_request(PM_QOS_CPU_DMA_LATENCY);
 	sleep_us = (uint32_t) ktime_to_ns(tick_nohz_get_sleep_length());
 	sleep_us = DIV_ROUND_UP(sleep_us, 1000);
+	sleep_us = msm_idle_predict(dev, latency_us, sleep_us);
 
 	for (i = 0; i < dev->state_count; i++) {
 		struct cpuidle_state *state = &dev->states[i];
@@ -782,6 +783,11 @@ int msm_pm_idle_prepare(struct cpuidle_device *dev)
 			state->flags &= ~CPUIDLE_FLAG_IGNORE;
 			state->target_residency = 0;
 			state->exit_latency = 0;
+			msm_idle_predict_state_cost(dev, i,
+					msm_pm_sleep_modes[idx].latency,
+					msm_pm_sleep_modes[idx].residency,
+					&state->exit_latency,
+					&state->target_residency);
 			state->power_usage = rs_limits->power[dev->cpu];
 
 			if (MSM_PM_SLEEP_MODE_POWER_COLLAPSE == mode)
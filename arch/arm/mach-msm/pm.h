@@ -126,4 +126,19 @@ static inline void msm_pm_add_stats(enum msm_pm_time_stats_id *enable_stats,
 static inline void msm_pm_add_stat(enum msm_pm_time_stats_id id, int64_t t) {}
 #endif
 
+#ifdef CONFIG_MSM_IDLE_PREDICT
+uint32_t msm_idle_predict(struct cpuidle_device *dev, uint32_t latency_us,
+		uint32_t timer_us);
+void msm_idle_predict_state_cost(struct cpuidle_device *dev, int idx,
+		uint32_t platform_latency_us, uint32_t platform_residency_us,
+		uint32_t *latency_us, uint32_t *residency_us);
+#else
+static inline uint32_t msm_idle_predict(struct cpuidle_device *dev,
+		uint32_t latency_us, uint32_t timer_us) { return timer_us; }
+static inline void msm_idle_predict_state_cost(struct cpuidle_device *dev,
+		int idx, uint32_t platform_latency_us,
+		uint32_t platform_residency_us, uint32_t *latency_us,
+		uint32_t *residency_us) {}
+#endif
+
 #endif  /* __ARCH_ARM_MACH_MSM_PM_H */
@@ -76,9 +76,12 @@ unsigned int diag_threshold_reg = 750;
 static struct timer_list drain_timer;
 static int timer_in_progress;
 void *buf_hdlc;
+/* Longest time, in ms, an encoded apps packet waits for aggregation */
+static unsigned int drain_timeout = 500;
 module_param(itemsize, uint, 0);
 module_param(poolsize, uint, 0);
 module_param(max_clients, uint, 0);
+module_param(drain_timeout, uint, S_IRUGO | S_IWUSR);
 
 /* delayed_rsp_id 0 represents no delay in the response. Any other number
     means that the diag packet has a delayed response. */
@@ -1089,35 +1092,25 @@ static int diagchar_write(struct file *file, const char __user *buf,
 		ret = -ENOMEM;
 		goto fail_free_hdlc;
 	}
-	if (HDLC_OUT_BUF_SIZE - driver->used <= (2*payload_size) + 3) {
-		err = diag_device_write(buf_hdlc, APPS_DATA, NULL);
-		if (err) {
-			/*Free the buffer right away if write failed */
-			diagmem_free(driver, buf_hdlc, POOL_TYPE_HDLC);
-			diagmem_free(driver, (unsigned char *)driver->
-				 write_ptr_svc, POOL_TYPE_WRITE_STRUCT);
-			ret = -EIO;
-			goto fail_free_hdlc;
-		}
-		buf_hdlc = NULL;
-		driver->used = 0;
-		buf_hdlc = diagmem_alloc(driver, HDLC_OUT_BUF_SIZE,
-							 POOL_TYPE_HDLC);
-		if (!buf_hdlc) {
-			ret = -ENOMEM;
-			goto fail_free_hdlc;
-		}
-	}
-
+	/*
+	 * Encode straight into the remaining space of the aggregation
+	 * buffer. Only if the packet does not fit is the buffer written
+	 * out and the packet encoded again into a fresh one, so USB
+	 * transfers stay as full as possible.
+	 */
 	enc.dest = buf_hdlc + driver->used;
-	enc.dest_last = (void *)(buf_hdlc + driver->used + 2*payload_size + 3);
+	enc.dest_last = (void *)(buf_hdlc + HDLC_OUT_BUF_SIZE - 1);
 	diag_hdlc_encode(&send, &enc);
 
-	/* This is to check if after HDLC encoding, we are still within the
-	 limits of aggregation buffer. If not, we write out the current buffer
-	and start aggregation in a newly allocated buffer */
-	if ((unsigned int) enc.dest >=
-		 (unsigned int)(buf_hdlc + HDLC_OUT_BUF_SIZE)) {
+	if (send.state != DIAG_STATE_COMPLETE) {
+		if (driver->used == 0) {
+			pr_err("diag: Dropping packet, encoded payload does"
+				" not fit in %d bytes\n", HDLC_OUT_BUF_SIZE);
+			driver->dropped_count++;
+			diagmem_free(driver, buf_hdlc, POOL_TYPE_HDLC);
+			ret = -EBADMSG;
+			goto fail_free_hdlc;
+		}
 		err = diag_device_write(buf_hdlc, APPS_DATA, NULL);
 		if (err) {
 			/*Free the buffer right away if write failed */
@@ -1135,10 +1128,21 @@ static int diagchar_write(struct file *file, const char __user *buf,
 			ret = -ENOMEM;
 			goto fail_free_hdlc;
 		}
-		enc.dest = buf_hdlc + driver->used;
-		enc.dest_last = (void *)(buf_hdlc + driver->used +
-							 (2*payload_size) + 3);
+
+		send.state = DIAG_STATE_START;
+		send.pkt = buf_copy;
+		send.last = (void *)(buf_copy + payload_size - 1);
+		enc.dest = buf_hdlc;
+		enc.dest_last = (void *)(buf_hdlc + HDLC_OUT_BUF_SIZE - 1);
 		diag_hdlc_encode(&send, &enc);
+		if (send.state != DIAG_STATE_COMPLETE) {
+			pr_err("diag: Dropping packet, encoded payload does"
+				" not fit in %d bytes\n", HDLC_OUT_BUF_SIZE);
+			driver->dropped_count++;
+			diagmem_free(driver, buf_hdlc, POOL_TYPE_HDLC);
+			ret = -EBADMSG;
+			goto fail_free_hdlc;
+		}
 	}
 
 	driver->used = (uint32_t) enc.dest - (uint32_t) buf_hdlc;
@@ -1160,7 +1164,8 @@ static int diagchar_write(struct file *file, const char __user *buf,
 	diagmem_free(driver, buf_copy, POOL_TYPE_COPY);
 	if (!timer_in_progress)	{
 		timer_in_progress = 1;
-		ret = mod_timer(&drain_timer, jiffies + msecs_to_jiffies(500));
+		ret = mod_timer(&drain_timer,
+				jiffies + msecs_to_jiffies(drain_timeout));
 	}
 	return 0;
 
@@ -1338,6 +1343,7 @@ static int __init diagchar_init(void)
 		driver->debug_flag = 1;
 		driver->dci_state = DIAG_DCI_NO_ERROR;
 		setup_timer(&drain_timer, drain_timer_func, 1234);
+		diag_hdlc_init();
 		driver->itemsize = itemsize;
 		driver->poolsize = poolsize;
 		driver->itemsize_hdlc = itemsize_hdlc;
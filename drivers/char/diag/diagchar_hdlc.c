@@ -18,6 +18,7 @@
 #include <linux/device.h>
 #include <linux/uaccess.h>
 #include <linux/crc-ccitt.h>
+#include <asm/byteorder.h>
 #include "diagchar_hdlc.h"
 #include "diagchar.h"
 
@@ -29,6 +30,92 @@ MODULE_LICENSE("GPL v2");
 #define CRC_16_L_STEP(xx_crc, xx_c) \
 	crc_ccitt_byte(xx_crc, xx_c)
 
+#define HDLC_WORD_ONES		0x01010101UL
+#define HDLC_WORD_HIGHS		0x80808080UL
+#define HDLC_WORD_CONTROL	(CONTROL_CHAR * HDLC_WORD_ONES)
+#define HDLC_WORD_ESC		(ESC_CHAR * HDLC_WORD_ONES)
+
+/* Non zero if any byte of the word is zero */
+#define HDLC_WORD_HAS_ZERO(w) \
+	(((w) - HDLC_WORD_ONES) & ~(w) & HDLC_WORD_HIGHS)
+
+/*
+ * Slicing-by-4 tables for the CCITT CRC.  crc_ccitt_table is the first
+ * slice, diag_crc_table[n] advances a byte through n + 1 more steps.
+ */
+static uint16_t diag_crc_table[3][256];
+
+void diag_hdlc_init(void)
+{
+	int i, n;
+	uint16_t crc;
+
+	for (i = 0; i < 256; i++) {
+		crc = crc_ccitt_table[i];
+		for (n = 0; n < 3; n++) {
+			crc = (crc >> 8) ^ crc_ccitt_table[crc & 0xff];
+			diag_crc_table[n][i] = crc;
+		}
+	}
+}
+
+static uint16_t diag_hdlc_crc(uint16_t crc, const uint8_t *buf,
+			      unsigned int len)
+{
+	uint32_t v;
+
+	while (len && ((unsigned long)buf & 3)) {
+		crc = CRC_16_L_STEP(crc, *buf++);
+		len--;
+	}
+
+	for (; len >= 4; len -= 4, buf += 4) {
+		v = le32_to_cpup((const __le32 *)buf) ^ crc;
+		crc = diag_crc_table[2][v & 0xff] ^
+		      diag_crc_table[1][(v >> 8) & 0xff] ^
+		      diag_crc_table[0][(v >> 16) & 0xff] ^
+		      crc_ccitt_table[v >> 24];
+	}
+
+	while (len--)
+		crc = CRC_16_L_STEP(crc, *buf++);
+
+	return crc;
+}
+
+/*
+ * Returns the number of leading bytes in buf, up to len, that need no
+ * escaping.  Aligned words are checked four bytes at a time.
+ */
+static unsigned int diag_hdlc_clean_len(const uint8_t *buf, unsigned int len)
+{
+	const uint8_t *p = buf;
+	const uint8_t *end = buf + len;
+	unsigned long w;
+
+	while (p < end && ((unsigned long)p & 3)) {
+		if (*p == CONTROL_CHAR || *p == ESC_CHAR)
+			return p - buf;
+		p++;
+	}
+
+	while (p + 4 <= end) {
+		w = *(const uint32_t *)p;
+		if (HDLC_WORD_HAS_ZERO(w ^ HDLC_WORD_CONTROL) ||
+		    HDLC_WORD_HAS_ZERO(w ^ HDLC_WORD_ESC))
+			break;
+		p += 4;
+	}
+
+	while (p < end) {
+		if (*p == CONTROL_CHAR || *p == ESC_CHAR)
+			break;
+		p++;
+	}
+
+	return p - buf;
+}
+
 void diag_hdlc_encode(struct diag_send_desc_type *src_desc,
 		      struct diag_hdlc_dest_type *enc)
 {
@@ -40,6 +127,7 @@ void diag_hdlc_encode(struct diag_send_desc_type *src_desc,
 	unsigned char src_byte = 0;
 	enum diag_send_state_enum_type state;
 	unsigned int used = 0;
+	unsigned int run;
 
 	if (src_desc && enc) {
 
@@ -65,34 +153,31 @@ void diag_hdlc_encode(struct diag_send_desc_type *src_desc,
 			   of 2 dest bytes for an escaped byte */
 			while (src <= src_last && dest <= dest_last) {
 
-				src_byte = *src++;
-
-				if ((src_byte == CONTROL_CHAR) ||
-				    (src_byte == ESC_CHAR)) {
-
-					/* If the escape character is not the
-					   last byte */
-					if (dest != dest_last) {
-						crc = CRC_16_L_STEP(crc,
-								    src_byte);
+				/* Copy the run of bytes needing no escape */
+				run = min(src_last - src, dest_last - dest) + 1;
+				run = diag_hdlc_clean_len(src, run);
+				if (run) {
+					crc = diag_hdlc_crc(crc, src, run);
+					memcpy(dest, src, run);
+					src += run;
+					dest += run;
+					used += run;
+					continue;
+				}
 
-						*dest++ = ESC_CHAR;
-						used++;
+				/* If the escape character is not the
+				   last byte */
+				if (dest == dest_last)
+					break;
 
-						*dest++ = src_byte
-							  ^ ESC_MASK;
-						used++;
-					} else {
+				src_byte = *src++;
+				crc = CRC_16_L_STEP(crc, src_byte);
 
-						src--;
-						break;
-					}
+				*dest++ = ESC_CHAR;
+				used++;
 
-				} else {
-					crc = CRC_16_L_STEP(crc, src_byte);
-					*dest++ = src_byte;
-					used++;
-				}
+				*dest++ = src_byte ^ ESC_MASK;
+				used++;
 			}
 
 			if (src > src_last) {
@@ -169,6 +254,7 @@ int diag_hdlc_decode(struct diag_hdlc_decode_type *hdlc)
 
 	unsigned int len = 0;
 	unsigned int i;
+	unsigned int run;
 	uint8_t src_byte;
 
 	int pkt_bnd = 0;
@@ -187,6 +273,20 @@ int diag_hdlc_decode(struct diag_hdlc_decode_type *hdlc)
 
 		for (i = 0; i < src_length; i++) {
 
+			if (!hdlc->escaping) {
+				run = min(src_length - i, dest_length - len);
+				run = diag_hdlc_clean_len(&src_ptr[i], run);
+				if (run) {
+					memcpy(&dest_ptr[len], &src_ptr[i],
+					       run);
+					len += run;
+					i += run;
+					if (len >= dest_length ||
+					    i == src_length)
+						break;
+				}
+			}
+
 			src_byte = src_ptr[i];
 
 			if (hdlc->escaping) {
@@ -48,6 +48,8 @@ struct diag_hdlc_decode_type {
 
 };
 
+void diag_hdlc_init(void);
+
 void diag_hdlc_encode(struct diag_send_desc_type *src_desc,
 		      struct diag_hdlc_dest_type *enc);
 
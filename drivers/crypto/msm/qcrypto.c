@@ -13,6 +13,7 @@
  */
 
 #include <linux/clk.h>
+#include <linux/module.h>
 #include <linux/types.h>
 #include <linux/platform_device.h>
 #include <linux/dma-mapping.h>
@@ -23,6 +24,8 @@
 #include <linux/interrupt.h>
 #include <linux/spinlock.h>
 #include <linux/debugfs.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
 
 #include <crypto/ctr.h>
 #include <crypto/des.h>
@@ -43,7 +46,23 @@
 
 #define MAX_CRYPTO_DEVICE 3
 #define DEBUG_MAX_FNAME  16
-#define DEBUG_MAX_RW_BUF 1024
+#define DEBUG_MAX_RW_BUF 2048
+
+/*
+ * Once this many requests are waiting for the engine, ablkcipher requests
+ * are run on the CPU through the software implementation instead of
+ * queueing behind the hardware. 0 disables the fallback.
+ */
+static unsigned int sw_fallback_qlen = 8;
+module_param(sw_fallback_qlen, uint, 0644);
+MODULE_PARM_DESC(sw_fallback_qlen,
+	"Engine queue depth at which ablkcipher falls back to software");
+
+struct crypto_path_stat {
+	u32 reqs;
+	u64 bytes;
+	u64 ns;
+};
 
 struct crypto_stat {
 	u32 aead_sha1_aes_enc;
@@ -70,6 +89,11 @@ struct crypto_stat {
 	u32 sha256_hmac_digest;
 	u32 sha_hmac_op_success;
 	u32 sha_hmac_op_fail;
+	u32 queue_max;
+	struct crypto_path_stat hw_cipher;
+	struct crypto_path_stat hw_aead;
+	struct crypto_path_stat hw_sha;
+	struct crypto_path_stat sw_cipher;
 };
 static struct crypto_stat _qcrypto_stat[MAX_CRYPTO_DEVICE];
 static struct dentry *_debug_dent;
@@ -98,6 +122,7 @@ struct crypto_priv {
 	/* current active request */
 	struct crypto_async_request *req;
 	int res;
+	ktime_t req_start;
 
 	/* request queue */
 	struct crypto_queue queue;
@@ -214,6 +239,10 @@ struct qcrypto_cipher_ctx {
 	unsigned int auth_key_len;
 
 	struct crypto_priv *cp;
+
+	/* software implementation used when the engine queue is deep */
+	struct crypto_blkcipher *fallback;
+	int fallback_ok;
 };
 
 struct qcrypto_cipher_req_ctx {
@@ -504,7 +533,23 @@ static int _qcrypto_ahash_hmac_cra_init(struct crypto_tfm *tfm)
 
 static int _qcrypto_cra_ablkcipher_init(struct crypto_tfm *tfm)
 {
+	struct qcrypto_cipher_ctx *ctx = crypto_tfm_ctx(tfm);
+	const char *name = crypto_tfm_alg_name(tfm);
+
 	tfm->crt_ablkcipher.reqsize = sizeof(struct qcrypto_cipher_req_ctx);
+
+	/*
+	 * The engine takes XTS keys in its own layout, so only modes whose
+	 * results are identical to the generic code get a fallback.
+	 */
+	ctx->fallback = NULL;
+	ctx->fallback_ok = 0;
+	if (strncmp(name, "xts(", 4)) {
+		ctx->fallback = crypto_alloc_blkcipher(name, 0,
+				CRYPTO_ALG_ASYNC | CRYPTO_ALG_NEED_FALLBACK);
+		if (IS_ERR(ctx->fallback))
+			ctx->fallback = NULL;
+	}
 	return _qcrypto_cipher_cra_init(tfm);
 };
 
@@ -518,6 +563,10 @@ static void _qcrypto_cra_ablkcipher_exit(struct crypto_tfm *tfm)
 {
 	struct qcrypto_cipher_ctx *ctx = crypto_tfm_ctx(tfm);
 
+	if (ctx->fallback) {
+		crypto_free_blkcipher(ctx->fallback);
+		ctx->fallback = NULL;
+	}
 	if (ctx->cp->platform_support.bus_scale_table != NULL)
 		qcrypto_ce_high_bw_req(ctx->cp, false);
 };
@@ -530,6 +579,26 @@ static void _qcrypto_cra_aead_exit(struct crypto_tfm *tfm)
 		qcrypto_ce_high_bw_req(ctx->cp, false);
 };
 
+static int _disp_path_stat(int len, const char *name,
+				struct crypto_path_stat *path)
+{
+	u64 kbps = 0;
+
+	if (path->ns)
+		kbps = div64_u64(path->bytes * 1000000ULL, path->ns);
+	return snprintf(_debug_read_buf + len, DEBUG_MAX_RW_BUF - len - 1,
+			"   %-9s requests %u bytes %llu KB/s %llu\n",
+			name, path->reqs, path->bytes, kbps);
+}
+
+static void _qcrypto_path_account(struct crypto_path_stat *path,
+				unsigned int nbytes, ktime_t start)
+{
+	path->reqs++;
+	path->bytes += nbytes;
+	path->ns += ktime_to_ns(ktime_sub(ktime_get(), start));
+}
+
 static int _disp_stats(int id)
 {
 	struct crypto_stat *pstat;
@@ -620,6 +689,13 @@ static int _disp_stats(int id)
 	len += snprintf(_debug_read_buf + len, DEBUG_MAX_RW_BUF - len - 1,
 			"   SHA HMAC operation success          : %d\n",
 					pstat->sha_hmac_op_success);
+	len += snprintf(_debug_read_buf + len, DEBUG_MAX_RW_BUF - len - 1,
+			"   Max queued requests          : %d\n",
+					pstat->queue_max);
+	len += _disp_path_stat(len, "HW CIPHER", &pstat->hw_cipher);
+	len += _disp_path_stat(len, "HW AEAD", &pstat->hw_aead);
+	len += _disp_path_stat(len, "HW SHA", &pstat->hw_sha);
+	len += _disp_path_stat(len, "SW CIPHER", &pstat->sw_cipher);
 	return len;
 }
 
@@ -653,6 +729,19 @@ static int _qcrypto_remove(struct platform_device *pdev)
 	return 0;
 };
 
+static void _qcrypto_setkey_fallback(struct crypto_ablkcipher *cipher,
+		const u8 *key, unsigned int len)
+{
+	struct qcrypto_cipher_ctx *ctx = crypto_ablkcipher_ctx(cipher);
+
+	if (!ctx->fallback)
+		return;
+	crypto_blkcipher_clear_flags(ctx->fallback, CRYPTO_TFM_REQ_MASK);
+	crypto_blkcipher_set_flags(ctx->fallback,
+		crypto_ablkcipher_get_flags(cipher) & CRYPTO_TFM_REQ_MASK);
+	ctx->fallback_ok = !crypto_blkcipher_setkey(ctx->fallback, key, len);
+}
+
 static int _qcrypto_setkey_aes(struct crypto_ablkcipher *cipher, const u8 *key,
 		unsigned int len)
 {
@@ -673,6 +762,7 @@ static int _qcrypto_setkey_aes(struct crypto_ablkcipher *cipher, const u8 *key,
 	};
 	ctx->enc_key_len = len;
 	memcpy(ctx->enc_key, key, len);
+	_qcrypto_setkey_fallback(cipher, key, len);
 	return 0;
 };
 
@@ -696,6 +786,7 @@ static int _qcrypto_setkey_des(struct crypto_ablkcipher *cipher, const u8 *key,
 
 	ctx->enc_key_len = len;
 	memcpy(ctx->enc_key, key, len);
+	_qcrypto_setkey_fallback(cipher, key, len);
 	return 0;
 };
 
@@ -711,6 +802,7 @@ static int _qcrypto_setkey_3des(struct crypto_ablkcipher *cipher, const u8 *key,
 	};
 	ctx->enc_key_len = len;
 	memcpy(ctx->enc_key, key, len);
+	_qcrypto_setkey_fallback(cipher, key, len);
 	return 0;
 };
 
@@ -720,14 +812,21 @@ static void req_done(unsigned long data)
 	struct crypto_priv *cp = (struct crypto_priv *)data;
 	unsigned long flags;
 
+	int res;
+
 	spin_lock_irqsave(&cp->lock, flags);
 	areq = cp->req;
 	cp->req = NULL;
+	res = cp->res;
 	spin_unlock_irqrestore(&cp->lock, flags);
 
-	if (areq)
-		areq->complete(areq, cp->res);
+	/*
+	 * Hand the engine its next request before running the completion,
+	 * so it is not left idle while the caller processes the result.
+	 */
 	_start_qcrypto_process(cp);
+	if (areq)
+		areq->complete(areq, res);
 };
 
 static void _update_sha1_ctx(struct ahash_request  *req)
@@ -789,6 +888,7 @@ static void _qce_ahash_complete(void *cookie, unsigned char *digest,
 		memcpy(sha_ctx->digest, digest, diglen);
 		memcpy(areq->result, digest, diglen);
 	}
+	_qcrypto_path_account(&pstat->hw_sha, areq->nbytes, cp->req_start);
 	if (authdata) {
 		sha_ctx->byte_count[0] = auth32[0];
 		sha_ctx->byte_count[1] = auth32[1];
@@ -841,6 +941,8 @@ static void _qce_ablk_cipher_complete(void *cookie, unsigned char *icb,
 #endif
 	if (iv)
 		memcpy(ctx->iv, iv, crypto_ablkcipher_ivsize(ablk));
+	_qcrypto_path_account(&pstat->hw_cipher, areq->nbytes,
+				cp->req_start);
 
 	if (ret) {
 		cp->res = -ENXIO;
@@ -868,6 +970,7 @@ static void _qce_aead_complete(void *cookie, unsigned char *icv,
 	pstat = &_qcrypto_stat[cp->pdev->id];
 
 	rctx = aead_request_ctx(areq);
+	_qcrypto_path_account(&pstat->hw_aead, areq->cryptlen, cp->req_start);
 
 	if (rctx->mode == QCE_MODE_CCM) {
 		kzfree(rctx->assoc);
@@ -1024,6 +1127,7 @@ again:
 	if (backlog)
 		backlog->complete(backlog, -EINPROGRESS);
 	type = crypto_tfm_alg_type(async_req->tfm);
+	cp->req_start = ktime_get();
 
 	if (type == CRYPTO_ALG_TYPE_ABLKCIPHER) {
 		struct ablkcipher_request *req;
@@ -1175,11 +1279,53 @@ done:
 	};
 };
 
+static int _qcrypto_sw_cipher(struct crypto_priv *cp,
+				struct ablkcipher_request *req)
+{
+	struct qcrypto_cipher_ctx *ctx = crypto_tfm_ctx(req->base.tfm);
+	struct qcrypto_cipher_req_ctx *rctx = ablkcipher_request_ctx(req);
+	struct crypto_stat *pstat = &_qcrypto_stat[cp->pdev->id];
+	struct blkcipher_desc desc;
+	ktime_t start = ktime_get();
+	unsigned long flags;
+	int ret;
+
+	desc.tfm = ctx->fallback;
+	desc.info = req->info;
+	desc.flags = req->base.flags & CRYPTO_TFM_REQ_MAY_SLEEP;
+	if (rctx->dir == QCE_ENCRYPT)
+		ret = crypto_blkcipher_encrypt_iv(&desc, req->dst, req->src,
+						req->nbytes);
+	else
+		ret = crypto_blkcipher_decrypt_iv(&desc, req->dst, req->src,
+						req->nbytes);
+
+	spin_lock_irqsave(&cp->lock, flags);
+	_qcrypto_path_account(&pstat->sw_cipher, req->nbytes, start);
+	if (ret)
+		pstat->ablk_cipher_op_fail++;
+	else
+		pstat->ablk_cipher_op_success++;
+	spin_unlock_irqrestore(&cp->lock, flags);
+	return ret;
+}
+
 static int _qcrypto_queue_req(struct crypto_priv *cp,
 				struct crypto_async_request *req)
 {
 	int ret;
 	unsigned long flags;
+	struct crypto_stat *pstat = &_qcrypto_stat[cp->pdev->id];
+
+	if (sw_fallback_qlen &&
+		crypto_tfm_alg_type(req->tfm) == CRYPTO_ALG_TYPE_ABLKCIPHER &&
+		cp->queue.qlen >= sw_fallback_qlen) {
+		struct qcrypto_cipher_ctx *ctx = crypto_tfm_ctx(req->tfm);
+
+		if (ctx->fallback_ok)
+			return _qcrypto_sw_cipher(cp, container_of(req,
+					struct ablkcipher_request, base));
+	}
 
 	if (cp->platform_support.ce_shared) {
 		ret = qcrypto_lock_ce(cp);
@@ -1189,6 +1335,8 @@ static int _qcrypto_queue_req(struct crypto_priv *cp,
 
 	spin_lock_irqsave(&cp->lock, flags);
 	ret = crypto_enqueue_request(&cp->queue, req);
+	if (cp->queue.qlen > pstat->queue_max)
+		pstat->queue_max = cp->queue.qlen;
 	spin_unlock_irqrestore(&cp->lock, flags);
 	_start_qcrypto_process(cp);
 
@@ -80,6 +80,7 @@ struct ion_client {
 	char *name;
 	struct task_struct *task;
 	pid_t pid;
+	struct mm_struct *mm;
 	struct dentry *debug_root;
 };
 
@@ -92,6 +93,7 @@ struct ion_client {
  * @kmap_cnt:		count of times this client has mapped to kernel
  * @dmap_cnt:		count of times this client has mapped for dma
  * @usermap_cnt:	count of times this client has mapped for userspace
+ * @charged:		buffer size is charged to the client's mm
  *
  * Modifications to node, map_cnt or mapping should be protected by the
  * lock in the client.  Other fields are never changed after initialization.
@@ -105,6 +107,7 @@ struct ion_handle {
 	unsigned int dmap_cnt;
 	unsigned int usermap_cnt;
 	unsigned int iommu_map_cnt;
+	bool charged;
 };
 
 static void ion_iommu_release(struct kref *kref);
@@ -309,6 +312,17 @@ static struct ion_handle *ion_handle_create(struct ion_client *client,
 	return handle;
 }
 
+/*
+ * Buffers allocated by a user client are charged to the client's mm so the
+ * low memory killer can account for them when picking a victim.
+ */
+static void ion_client_charge_mm(struct ion_client *client, long size)
+{
+	if (client->mm)
+		add_mm_counter(client->mm, MM_UNRECLAIMABLE,
+			       size >> PAGE_SHIFT);
+}
+
 /* Client lock must be locked when calling */
 static void ion_handle_destroy(struct kref *kref)
 {
@@ -317,6 +331,9 @@ static void ion_handle_destroy(struct kref *kref)
 	   if (handle->map_cnt) unmap
 	 */
 	WARN_ON(handle->kmap_cnt || handle->dmap_cnt || handle->usermap_cnt);
+	if (handle->charged)
+		ion_client_charge_mm(handle->client,
+				     -(long) handle->buffer->size);
 	ion_buffer_put(handle->buffer);
 	if (!RB_EMPTY_NODE(&handle->node))
 		rb_erase(&handle->node, &handle->client->handles);
@@ -463,6 +480,9 @@ struct ion_handle *ion_alloc(struct ion_client *client, size_t len,
 	 */
 	ion_buffer_put(buffer);
 
+	handle->charged = true;
+	ion_client_charge_mm(client, buffer->size);
+
 	mutex_lock(&client->lock);
 	ion_handle_add(client, handle);
 	mutex_unlock(&client->lock);
@@ -1138,6 +1158,11 @@ struct ion_client *ion_client_create(struct ion_device *dev,
 	client->heap_mask = heap_mask;
 	client->task = task;
 	client->pid = pid;
+	/* pin the mm_struct only, so exit can still tear down the mappings */
+	if (task && current->mm) {
+		client->mm = current->mm;
+		atomic_inc(&client->mm->mm_count);
+	}
 	kref_init(&client->ref);
 
 	mutex_lock(&dev->lock);
@@ -1200,6 +1225,8 @@ static void _ion_client_destroy(struct kref *kref)
 	debugfs_remove_recursive(client->debug_root);
 	mutex_unlock(&dev->lock);
 
+	if (client->mm)
+		mmdrop(client->mm);
 	kfree(client->name);
 	kfree(client);
 }
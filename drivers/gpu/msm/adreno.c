@@ -12,6 +12,7 @@
  */
 #include <linux/uaccess.h>
 #include <linux/vmalloc.h>
+#include <linux/slab.h>
 #include <linux/ioctl.h>
 #include <linux/sched.h>
 
@@ -108,6 +109,7 @@ static struct adreno_device device_3d0 = {
 	.pm4_fw = NULL,
 	.wait_timeout = 10000, /* in milliseconds */
 	.ib_check_level = 0,
+	.perfcounter_users = LIST_HEAD_INIT(device_3d0.perfcounter_users),
 };
 
 /* This set of registers are used for Hang detection
@@ -775,6 +777,9 @@ static int adreno_start(struct kgsl_device *device, unsigned int init_ram)
 	/* Start the GPU */
 	adreno_dev->gpudev->start(adreno_dev);
 
+	/* Reprogram any counters that were reserved before power collapse */
+	adreno_perfcounter_start(adreno_dev);
+
 	kgsl_pwrctrl_irq(device, KGSL_PWRFLAGS_ON);
 	device->ftbl->irqctrl(device, 1);
 
@@ -1650,10 +1655,359 @@ static unsigned int adreno_readtimestamp(struct kgsl_device *device,
 	return timestamp;
 }
 
+static struct adreno_perfcount_group *
+adreno_perfcounter_group(struct adreno_device *adreno_dev,
+	unsigned int groupid)
+{
+	struct adreno_perfcounters *counters = adreno_dev->gpudev->perfcounters;
+
+	if (counters == NULL || groupid >= counters->group_count)
+		return NULL;
+
+	return &counters->groups[groupid];
+}
+
+static struct adreno_perfcount_register *
+adreno_perfcounter_find(struct adreno_device *adreno_dev,
+	unsigned int groupid, unsigned int countable)
+{
+	struct adreno_perfcount_group *group;
+	unsigned int i;
+
+	group = adreno_perfcounter_group(adreno_dev, groupid);
+	if (group == NULL || countable == KGSL_PERFCOUNTER_NOT_USED)
+		return NULL;
+
+	for (i = 0; i < group->reg_count; i++)
+		if (group->regs[i].countable == countable)
+			return &group->regs[i];
+
+	return NULL;
+}
+
+/**
+ * adreno_perfcounter_get - reserve a performance counter
+ * @adreno_dev - The 3D device
+ * @groupid - KGSL_PERFCOUNTER_GROUP_* id of the hardware block
+ * @countable - countable to select
+ * @offset - returns the register offset of the low dword of the counter
+ *
+ * Reserve a counter for the countable, sharing it with any other user
+ * counting the same countable.  Must be called with the device mutex held.
+ */
+
+int adreno_perfcounter_get(struct adreno_device *adreno_dev,
+	unsigned int groupid, unsigned int countable, unsigned int *offset)
+{
+	struct kgsl_device *device = &adreno_dev->dev;
+	struct adreno_perfcount_group *group;
+	struct adreno_perfcount_register *reg;
+	unsigned int i;
+
+	group = adreno_perfcounter_group(adreno_dev, groupid);
+	if (group == NULL || countable == KGSL_PERFCOUNTER_NOT_USED)
+		return -EINVAL;
+
+	reg = adreno_perfcounter_find(adreno_dev, groupid, countable);
+	if (reg) {
+		reg->refcount++;
+		*offset = reg->offset;
+		return 0;
+	}
+
+	for (i = 0; i < group->reg_count; i++) {
+		if (group->regs[i].select && group->regs[i].refcount == 0) {
+			reg = &group->regs[i];
+			break;
+		}
+	}
+
+	if (reg == NULL)
+		return -EBUSY;
+
+	reg->countable = countable;
+	reg->refcount = 1;
+	*offset = reg->offset;
+
+	/* Program the counter now, it is reprogrammed on every start */
+	kgsl_pwrctrl_wake(device);
+	if (device->state == KGSL_STATE_ACTIVE)
+		adreno_dev->gpudev->perfcounter_enable(adreno_dev, reg);
+
+	return 0;
+}
+
+/**
+ * adreno_perfcounter_put - release a performance counter
+ * @adreno_dev - The 3D device
+ * @groupid - KGSL_PERFCOUNTER_GROUP_* id of the hardware block
+ * @countable - countable that was reserved
+ *
+ * Drop a reservation taken with adreno_perfcounter_get.  The counter is
+ * free for another countable once the last user releases it.
+ */
+
+int adreno_perfcounter_put(struct adreno_device *adreno_dev,
+	unsigned int groupid, unsigned int countable)
+{
+	struct adreno_perfcount_register *reg;
+
+	reg = adreno_perfcounter_find(adreno_dev, groupid, countable);
+	if (reg == NULL || reg->refcount == 0)
+		return -EINVAL;
+
+	reg->refcount--;
+
+	/* Fixed function counters always keep their countable */
+	if (reg->refcount == 0 && reg->select)
+		reg->countable = KGSL_PERFCOUNTER_NOT_USED;
+
+	return 0;
+}
+
+/**
+ * adreno_perfcounter_read - read the current value of a counter
+ * @adreno_dev - The 3D device
+ * @groupid - KGSL_PERFCOUNTER_GROUP_* id of the hardware block
+ * @countable - countable that was reserved
+ * @value - returns the 64 bit counter value
+ */
+
+int adreno_perfcounter_read(struct adreno_device *adreno_dev,
+	unsigned int groupid, unsigned int countable, uint64_t *value)
+{
+	struct kgsl_device *device = &adreno_dev->dev;
+	struct adreno_perfcount_register *reg;
+
+	reg = adreno_perfcounter_find(adreno_dev, groupid, countable);
+	if (reg == NULL || (reg->select && reg->refcount == 0))
+		return -EINVAL;
+
+	kgsl_pwrctrl_wake(device);
+	if (device->state != KGSL_STATE_ACTIVE)
+		return -EAGAIN;
+
+	*value = adreno_dev->gpudev->perfcounter_read(adreno_dev, reg);
+	return 0;
+}
+
+/**
+ * adreno_perfcounter_start - program all reserved counters
+ * @adreno_dev - The 3D device
+ *
+ * The counter selects are lost on power collapse, restore them when the
+ * GPU is started.
+ */
+
+void adreno_perfcounter_start(struct adreno_device *adreno_dev)
+{
+	struct adreno_perfcounters *counters = adreno_dev->gpudev->perfcounters;
+	struct adreno_perfcount_register *reg;
+	unsigned int i, j;
+
+	if (counters == NULL)
+		return;
+
+	for (i = 0; i < counters->group_count; i++) {
+		for (j = 0; j < counters->groups[i].reg_count; j++) {
+			reg = &counters->groups[i].regs[j];
+			if (reg->refcount)
+				adreno_dev->gpudev->perfcounter_enable(
+					adreno_dev, reg);
+		}
+	}
+}
+
+/*
+ * A counter reserved through the ioctls, owned by the file that reserved it
+ * so that it can be given back when the file is closed
+ */
+struct adreno_perfcounter_user {
+	struct kgsl_device_private *dev_priv;
+	unsigned int groupid;
+	unsigned int countable;
+	struct list_head node;
+};
+
+/*
+ * The per-context SP and TP samples are only taken while somebody is
+ * profiling those blocks, so they don't cost a counter or any context
+ * switch commands otherwise
+ */
+static int adreno_perfcounter_sampled(unsigned int groupid)
+{
+	return groupid == KGSL_PERFCOUNTER_GROUP_SP ||
+		groupid == KGSL_PERFCOUNTER_GROUP_TP;
+}
+
+static void adreno_perfcounter_user_del(struct adreno_device *adreno_dev,
+	struct adreno_perfcounter_user *user)
+{
+	adreno_perfcounter_put(adreno_dev, user->groupid, user->countable);
+
+	if (adreno_perfcounter_sampled(user->groupid) &&
+		--adreno_dev->perfcounter_sample_users == 0 &&
+		adreno_dev->gpudev->perfcounter_sample)
+		adreno_dev->gpudev->perfcounter_sample(adreno_dev, 0);
+
+	list_del(&user->node);
+	kfree(user);
+}
+
+static int adreno_ioctl_perfcounter_get(struct kgsl_device_private *dev_priv,
+	struct kgsl_perfcounter_get *get)
+{
+	struct adreno_device *adreno_dev = ADRENO_DEVICE(dev_priv->device);
+	struct adreno_perfcounter_user *user;
+	int ret;
+
+	user = kzalloc(sizeof(*user), GFP_KERNEL);
+	if (user == NULL)
+		return -ENOMEM;
+
+	ret = adreno_perfcounter_get(adreno_dev, get->groupid,
+		get->countable, &get->offset);
+	if (ret) {
+		kfree(user);
+		return ret;
+	}
+
+	user->dev_priv = dev_priv;
+	user->groupid = get->groupid;
+	user->countable = get->countable;
+	list_add(&user->node, &adreno_dev->perfcounter_users);
+
+	if (adreno_perfcounter_sampled(get->groupid) &&
+		adreno_dev->perfcounter_sample_users++ == 0 &&
+		adreno_dev->gpudev->perfcounter_sample)
+		adreno_dev->gpudev->perfcounter_sample(adreno_dev, 1);
+
+	return 0;
+}
+
+static int adreno_ioctl_perfcounter_put(struct kgsl_device_private *dev_priv,
+	struct kgsl_perfcounter_put *put)
+{
+	struct adreno_device *adreno_dev = ADRENO_DEVICE(dev_priv->device);
+	struct adreno_perfcounter_user *user;
+
+	/* Only the file that took a reservation can drop it */
+	list_for_each_entry(user, &adreno_dev->perfcounter_users, node) {
+		if (user->dev_priv == dev_priv &&
+			user->groupid == put->groupid &&
+			user->countable == put->countable) {
+			adreno_perfcounter_user_del(adreno_dev, user);
+			return 0;
+		}
+	}
+
+	return -EINVAL;
+}
+
+/**
+ * adreno_perfcounter_release - drop the counters reserved by a file
+ * @dev_priv - The file being closed
+ *
+ * Called with the device mutex held when the file is released.
+ */
+
+void adreno_perfcounter_release(struct kgsl_device_private *dev_priv)
+{
+	struct adreno_device *adreno_dev = ADRENO_DEVICE(dev_priv->device);
+	struct adreno_perfcounter_user *user, *tmp;
+
+	list_for_each_entry_safe(user, tmp, &adreno_dev->perfcounter_users,
+		node) {
+		if (user->dev_priv == dev_priv)
+			adreno_perfcounter_user_del(adreno_dev, user);
+	}
+}
+
+static unsigned int adreno_perfcounter_total(struct adreno_device *adreno_dev)
+{
+	struct adreno_perfcounters *counters = adreno_dev->gpudev->perfcounters;
+	unsigned int i, total = 0;
+
+	if (counters == NULL)
+		return 0;
+
+	for (i = 0; i < counters->group_count; i++)
+		total += counters->groups[i].reg_count;
+
+	return total;
+}
+
+static int adreno_ioctl_perfcounter_read(struct adreno_device *adreno_dev,
+	struct kgsl_perfcounter_read *read)
+{
+	struct kgsl_perfcounter_read_group __user *reads = read->reads;
+	struct kgsl_perfcounter_read_group *groups;
+	unsigned int i, size;
+	int ret = 0;
+
+	if (read->count == 0)
+		return 0;
+
+	/* No need to read a counter twice, bound the work done under the lock */
+	if (read->count > adreno_perfcounter_total(adreno_dev))
+		return -EINVAL;
+
+	size = read->count * sizeof(*groups);
+	groups = kmalloc(size, GFP_KERNEL);
+	if (groups == NULL)
+		return -ENOMEM;
+
+	if (copy_from_user(groups, reads, size)) {
+		ret = -EFAULT;
+		goto done;
+	}
+
+	for (i = 0; i < read->count; i++) {
+		ret = adreno_perfcounter_read(adreno_dev, groups[i].groupid,
+			groups[i].countable, &groups[i].value);
+		if (ret)
+			goto done;
+	}
+
+	if (copy_to_user(reads, groups, size))
+		ret = -EFAULT;
+
+done:
+	kfree(groups);
+	return ret;
+}
+
+static int adreno_ioctl_drawctxt_perfcounters(
+	struct kgsl_device_private *dev_priv,
+	struct kgsl_drawctxt_perfcounters *param)
+{
+	struct adreno_device *adreno_dev = ADRENO_DEVICE(dev_priv->device);
+	struct kgsl_context *context;
+	struct adreno_context *drawctxt;
+
+	context = kgsl_find_context(dev_priv, param->drawctxt_id);
+	if (context == NULL || context->devctxt == NULL)
+		return -EINVAL;
+
+	drawctxt = context->devctxt;
+	if (drawctxt->perf_samples.hostptr == NULL)
+		return -ENODEV;
+
+	adreno_drawctxt_perf_harvest(adreno_dev, drawctxt);
+
+	param->dropped = drawctxt->perf_dropped;
+	param->busy_cycles = drawctxt->perf_totals[ADRENO_CTX_PERF_BUSY];
+	param->alu_active_cycles = drawctxt->perf_totals[ADRENO_CTX_PERF_ALU];
+	param->tex_cache_misses = drawctxt->perf_totals[ADRENO_CTX_PERF_TEX];
+
+	return 0;
+}
+
 static long adreno_ioctl(struct kgsl_device_private *dev_priv,
 			      unsigned int cmd, void *data)
 {
 	int result = 0;
+	struct adreno_device *adreno_dev = ADRENO_DEVICE(dev_priv->device);
 	struct kgsl_drawctxt_set_bin_base_offset *binbase;
 	struct kgsl_context *context;
 
@@ -1680,6 +2034,22 @@ static long adreno_ioctl(struct kgsl_device_private *dev_priv,
 		}
 		break;
 
+	case IOCTL_KGSL_PERFCOUNTER_GET:
+		result = adreno_ioctl_perfcounter_get(dev_priv, data);
+		break;
+
+	case IOCTL_KGSL_PERFCOUNTER_PUT:
+		result = adreno_ioctl_perfcounter_put(dev_priv, data);
+		break;
+
+	case IOCTL_KGSL_PERFCOUNTER_READ:
+		result = adreno_ioctl_perfcounter_read(adreno_dev, data);
+		break;
+
+	case IOCTL_KGSL_DRAWCTXT_PERFCOUNTERS:
+		result = adreno_ioctl_drawctxt_perfcounters(dev_priv, data);
+		break;
+
 	default:
 		KGSL_DRV_INFO(dev_priv->device,
 			"invalid ioctl code %08x\n", cmd);
@@ -1775,6 +2145,7 @@ static const struct kgsl_functable adreno_functable = {
 	.drawctxt_create = adreno_drawctxt_create,
 	.drawctxt_destroy = adreno_drawctxt_destroy,
 	.setproperty = adreno_setproperty,
+	.release = adreno_perfcounter_release,
 };
 
 static struct platform_device_id adreno_id_table[] = {
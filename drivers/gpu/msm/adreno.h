@@ -36,7 +36,9 @@
 #define KGSL_START_OF_IB_IDENTIFIER	0x2EADEABE
 #define KGSL_END_OF_IB_IDENTIFIER	0x2ABEDEAD
 
-#ifdef CONFIG_MSM_SCM
+#ifdef CONFIG_MSM_KGSL_PWRSCALE_ONDEMAND
+#define ADRENO_DEFAULT_PWRSCALE_POLICY  (&kgsl_pwrscale_policy_ondemand)
+#elif defined CONFIG_MSM_SCM
 #define ADRENO_DEFAULT_PWRSCALE_POLICY  (&kgsl_pwrscale_policy_tz)
 #elif defined CONFIG_MSM_SLEEP_STATS_DEVICE
 #define ADRENO_DEFAULT_PWRSCALE_POLICY  (&kgsl_pwrscale_policy_idlestats)
@@ -83,8 +85,46 @@ struct adreno_device {
 	unsigned int instruction_size;
 	unsigned int ib_check_level;
 	unsigned int fast_hang_detect;
+	struct list_head perfcounter_users;
+	unsigned int perfcounter_sample_users;
 };
 
+/**
+ * struct adreno_perfcount_register: register state
+ * @countable: countable the register holds
+ * @refcount: number of users of the register
+ * @offset: register hardware offset (low dword of the counter)
+ * @select: select register offset, 0 for fixed function counters
+ */
+struct adreno_perfcount_register {
+	unsigned int countable;
+	unsigned int refcount;
+	unsigned int offset;
+	unsigned int select;
+};
+
+/**
+ * struct adreno_perfcount_group: registers for a hardware group
+ * @regs: available registers for this group
+ * @reg_count: total registers for this group
+ */
+struct adreno_perfcount_group {
+	struct adreno_perfcount_register *regs;
+	unsigned int reg_count;
+};
+
+/**
+ * struct adreno_perfcounters: all available perfcounter groups
+ * @groups: available groups for this device
+ * @group_count: total groups for this device
+ */
+struct adreno_perfcounters {
+	struct adreno_perfcount_group *groups;
+	unsigned int group_count;
+};
+
+#define KGSL_PERFCOUNTER_NOT_USED 0xFFFFFFFF
+
 struct adreno_gpudev {
 	/*
 	 * These registers are in a different location on A3XX,  so define
@@ -108,6 +148,14 @@ struct adreno_gpudev {
 	void (*rb_init)(struct adreno_device *, struct adreno_ringbuffer *);
 	void (*start)(struct adreno_device *);
 	unsigned int (*busy_cycles)(struct adreno_device *);
+
+	/* Performance counters, NULL if the GPU does not expose any */
+	struct adreno_perfcounters *perfcounters;
+	void (*perfcounter_enable)(struct adreno_device *,
+		struct adreno_perfcount_register *);
+	uint64_t (*perfcounter_read)(struct adreno_device *,
+		struct adreno_perfcount_register *);
+	void (*perfcounter_sample)(struct adreno_device *, int);
 };
 
 extern struct adreno_gpudev adreno_a2xx_gpudev;
@@ -154,6 +202,15 @@ int adreno_dump_and_recover(struct kgsl_device *device);
 unsigned int adreno_hang_detect(struct kgsl_device *device,
 						unsigned int *prev_reg_val);
 
+int adreno_perfcounter_get(struct adreno_device *adreno_dev,
+	unsigned int groupid, unsigned int countable, unsigned int *offset);
+int adreno_perfcounter_put(struct adreno_device *adreno_dev,
+	unsigned int groupid, unsigned int countable);
+int adreno_perfcounter_read(struct adreno_device *adreno_dev,
+	unsigned int groupid, unsigned int countable, uint64_t *value);
+void adreno_perfcounter_start(struct adreno_device *adreno_dev);
+void adreno_perfcounter_release(struct kgsl_device_private *dev_priv);
+
 static inline int adreno_is_a200(struct adreno_device *adreno_dev)
 {
 	return (adreno_dev->gpurev == ADRENO_REV_A200);
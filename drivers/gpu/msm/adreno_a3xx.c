@@ -2305,6 +2305,147 @@ static int a3xx_create_gmem_shadow(struct adreno_device *adreno_dev,
 	return 0;
 }
 
+/* Counter registers sampled per context, indexed by adreno_ctx_perfcounter */
+static unsigned int a3xx_ctx_perf_regs[ADRENO_CTX_PERFCOUNTERS];
+static int a3xx_ctx_perf_reserved;
+
+static int a3xx_ctx_perf_reserve(struct adreno_device *adreno_dev)
+{
+	int ret;
+
+	ret = adreno_perfcounter_get(adreno_dev, KGSL_PERFCOUNTER_GROUP_PWR, 1,
+		&a3xx_ctx_perf_regs[ADRENO_CTX_PERF_BUSY]);
+	if (ret)
+		return ret;
+
+	ret = adreno_perfcounter_get(adreno_dev, KGSL_PERFCOUNTER_GROUP_SP,
+		SP_ALU_ACTIVE_CYCLES, &a3xx_ctx_perf_regs[ADRENO_CTX_PERF_ALU]);
+	if (ret)
+		goto put_busy;
+
+	ret = adreno_perfcounter_get(adreno_dev, KGSL_PERFCOUNTER_GROUP_TP,
+		TP_L1_CACHELINE_MISSES,
+		&a3xx_ctx_perf_regs[ADRENO_CTX_PERF_TEX]);
+	if (ret)
+		goto put_alu;
+
+	return 0;
+
+put_alu:
+	adreno_perfcounter_put(adreno_dev, KGSL_PERFCOUNTER_GROUP_SP,
+		SP_ALU_ACTIVE_CYCLES);
+put_busy:
+	adreno_perfcounter_put(adreno_dev, KGSL_PERFCOUNTER_GROUP_PWR, 1);
+	return ret;
+}
+
+static void a3xx_ctx_perf_release(struct adreno_device *adreno_dev)
+{
+	adreno_perfcounter_put(adreno_dev, KGSL_PERFCOUNTER_GROUP_TP,
+		TP_L1_CACHELINE_MISSES);
+	adreno_perfcounter_put(adreno_dev, KGSL_PERFCOUNTER_GROUP_SP,
+		SP_ALU_ACTIVE_CYCLES);
+	adreno_perfcounter_put(adreno_dev, KGSL_PERFCOUNTER_GROUP_PWR, 1);
+}
+
+/*
+ * Per-context sampling is turned on while a client holds an SP or TP
+ * counter.  It is best effort, if the counters are busy the contexts are
+ * simply not sampled.
+ */
+static void a3xx_perfcounter_sample(struct adreno_device *adreno_dev,
+	int enable)
+{
+	struct adreno_context *drawctxt = adreno_dev->drawctxt_active;
+
+	if (enable) {
+		if (!a3xx_ctx_perf_reserved &&
+			a3xx_ctx_perf_reserve(adreno_dev) == 0)
+			a3xx_ctx_perf_reserved = 1;
+		return;
+	}
+
+	if (!a3xx_ctx_perf_reserved)
+		return;
+
+	/*
+	 * The counters may be reassigned from here on, so forget the sample
+	 * opened for the active context.  The slot is reused as perf_head
+	 * never advanced.
+	 */
+	if (drawctxt)
+		drawctxt->flags &= ~CTXT_FLAGS_PERF_SAMPLE;
+
+	a3xx_ctx_perf_release(adreno_dev);
+	a3xx_ctx_perf_reserved = 0;
+}
+
+/*
+ * Have the GPU copy the per-context counters into the current sample slot.
+ * No explicit idle is needed: every command group issued by the ringbuffer
+ * ends with a CP_WAIT_FOR_IDLE, so all prior work is reflected in the
+ * counters when the copy executes.
+ */
+static void a3xx_drawctxt_perf_sample(struct adreno_device *adreno_dev,
+	struct adreno_context *drawctxt, int end)
+{
+	unsigned int cmds[ADRENO_CTX_PERFCOUNTERS * 3];
+	unsigned int *cmd = cmds;
+	unsigned int slot, gpuaddr, i;
+
+	slot = drawctxt->perf_head % ADRENO_CTX_PERF_SLOTS;
+	gpuaddr = drawctxt->perf_samples.gpuaddr +
+		slot * sizeof(struct adreno_ctx_perf_slot);
+	gpuaddr += end ? offsetof(struct adreno_ctx_perf_slot, end) :
+		offsetof(struct adreno_ctx_perf_slot, start);
+
+	for (i = 0; i < ADRENO_CTX_PERFCOUNTERS; i++) {
+		/* Copy both the low and high dword of the counter */
+		*cmd++ = cp_type3_packet(CP_REG_TO_MEM, 2);
+		*cmd++ = (2 << REG_TO_MEM_LOOP_COUNT_SHIFT) |
+			a3xx_ctx_perf_regs[i];
+		*cmd++ = gpuaddr + i * sizeof(uint64_t);
+	}
+
+	adreno_ringbuffer_issuecmds(&adreno_dev->dev, drawctxt,
+		KGSL_CMD_FLAGS_NONE, cmds, cmd - cmds);
+}
+
+static void a3xx_drawctxt_perf_start(struct adreno_device *adreno_dev,
+	struct adreno_context *drawctxt)
+{
+	if (!a3xx_ctx_perf_reserved || drawctxt->perf_samples.hostptr == NULL)
+		return;
+
+	adreno_drawctxt_perf_harvest(adreno_dev, drawctxt);
+
+	if (drawctxt->perf_head - drawctxt->perf_tail >=
+		ADRENO_CTX_PERF_SLOTS) {
+		drawctxt->perf_dropped++;
+		return;
+	}
+
+	a3xx_drawctxt_perf_sample(adreno_dev, drawctxt, 0);
+	drawctxt->flags |= CTXT_FLAGS_PERF_SAMPLE;
+}
+
+static void a3xx_drawctxt_perf_end(struct adreno_device *adreno_dev,
+	struct adreno_context *drawctxt)
+{
+	unsigned int slot = drawctxt->perf_head % ADRENO_CTX_PERF_SLOTS;
+
+	if (!(drawctxt->flags & CTXT_FLAGS_PERF_SAMPLE))
+		return;
+
+	a3xx_drawctxt_perf_sample(adreno_dev, drawctxt, 1);
+
+	/* The slot is complete once the global timestamp just issued retires */
+	drawctxt->perf_timestamp[slot] =
+		adreno_dev->ringbuffer.timestamp[KGSL_MEMSTORE_GLOBAL];
+	drawctxt->perf_head++;
+	drawctxt->flags &= ~CTXT_FLAGS_PERF_SAMPLE;
+}
+
 static int a3xx_drawctxt_create(struct adreno_device *adreno_dev,
 	struct adreno_context *drawctxt)
 {
@@ -2338,10 +2479,22 @@ static int a3xx_drawctxt_create(struct adreno_device *adreno_dev,
 		ret = a3xx_create_gmem_shadow(adreno_dev, drawctxt);
 
 done:
-	if (ret)
+	if (ret) {
 		kgsl_sharedmem_free(&drawctxt->gpustate);
+		return ret;
+	}
 
-	return ret;
+	/*
+	 * Per-context counter sampling is best effort, the context works
+	 * fine without it
+	 */
+	if (kgsl_allocate(&drawctxt->perf_samples, drawctxt->pagetable,
+			ADRENO_CTX_PERF_SLOTS *
+			sizeof(struct adreno_ctx_perf_slot)) == 0)
+		kgsl_sharedmem_set(&drawctxt->perf_samples, 0, 0,
+			drawctxt->perf_samples.size);
+
+	return 0;
 }
 
 static void a3xx_drawctxt_save(struct adreno_device *adreno_dev,
@@ -2356,6 +2509,9 @@ static void a3xx_drawctxt_save(struct adreno_device *adreno_dev,
 		KGSL_CTXT_WARN(device,
 			       "Current active context has caused gpu hang\n");
 
+	/* Close the counter sample before the save commands run */
+	a3xx_drawctxt_perf_end(adreno_dev, context);
+
 	if (!(context->flags & CTXT_FLAGS_PREAMBLE)) {
 		/* Fixup self modifying IBs for save operations */
 		adreno_ringbuffer_issuecmds(device, context,
@@ -2451,6 +2607,9 @@ static void a3xx_drawctxt_restore(struct adreno_device *adreno_dev,
 			KGSL_CMD_FLAGS_NONE,
 			context->hlsqcontrol_restore, 3);
 	}
+
+	/* Open a counter sample once the restore commands are queued */
+	a3xx_drawctxt_perf_start(adreno_dev, context);
 }
 
 static void a3xx_rb_init(struct adreno_device *adreno_dev,
@@ -2671,29 +2830,211 @@ static void a3xx_irq_control(struct adreno_device *adreno_dev, int state)
 		adreno_regwrite(device, A3XX_RBBM_INT_0_MASK, 0);
 }
 
+/* Value of the busy counter at the last call to a3xx_busy_cycles */
+static unsigned int a3xx_busy_prev;
+
 static unsigned int a3xx_busy_cycles(struct adreno_device *adreno_dev)
 {
 	struct kgsl_device *device = &adreno_dev->dev;
-	unsigned int reg, val;
+	unsigned int val, ret;
 
-	/* Freeze the counter */
-	adreno_regread(device, A3XX_RBBM_RBBM_CTL, &reg);
-	reg &= ~RBBM_RBBM_CTL_ENABLE_PWR_CTR1;
-	adreno_regwrite(device, A3XX_RBBM_RBBM_CTL, reg);
-
-	/* Read the value */
+	/*
+	 * The counter is left free running so that it can also be sampled
+	 * on context switch. Report the cycles since the last call.
+	 */
 	adreno_regread(device, A3XX_RBBM_PERFCTR_PWR_1_LO, &val);
 
-	/* Reset the counter */
-	reg |= RBBM_RBBM_CTL_RESET_PWR_CTR1;
-	adreno_regwrite(device, A3XX_RBBM_RBBM_CTL, reg);
+	ret = val - a3xx_busy_prev;
+	a3xx_busy_prev = val;
+
+	return ret;
+}
+
+/*
+ * Define the available perfcounter groups - these get used by
+ * adreno_perfcounter_get and adreno_perfcounter_put
+ */
+
+static struct adreno_perfcount_register a3xx_perfcounters_cp[] = {
+	{ KGSL_PERFCOUNTER_NOT_USED, 0, A3XX_RBBM_PERFCTR_CP_0_LO,
+		A3XX_CP_PERFCOUNTER_SELECT },
+};
+
+static struct adreno_perfcount_register a3xx_perfcounters_rbbm[] = {
+	{ KGSL_PERFCOUNTER_NOT_USED, 0, A3XX_RBBM_PERFCTR_RBBM_0_LO,
+		A3XX_RBBM_PERFCOUNTER0_SELECT },
+	{ KGSL_PERFCOUNTER_NOT_USED, 0, A3XX_RBBM_PERFCTR_RBBM_1_LO,
+		A3XX_RBBM_PERFCOUNTER1_SELECT },
+};
+
+static struct adreno_perfcount_register a3xx_perfcounters_pc[] = {
+	{ KGSL_PERFCOUNTER_NOT_USED, 0, A3XX_RBBM_PERFCTR_PC_0_LO,
+		A3XX_PC_PERFCOUNTER0_SELECT },
+	{ KGSL_PERFCOUNTER_NOT_USED, 0, A3XX_RBBM_PERFCTR_PC_1_LO,
+		A3XX_PC_PERFCOUNTER1_SELECT },
+	{ KGSL_PERFCOUNTER_NOT_USED, 0, A3XX_RBBM_PERFCTR_PC_2_LO,
+		A3XX_PC_PERFCOUNTER2_SELECT },
+	{ KGSL_PERFCOUNTER_NOT_USED, 0, A3XX_RBBM_PERFCTR_PC_3_LO,
+		A3XX_PC_PERFCOUNTER3_SELECT },
+};
+
+/*
+ * VFD counter 0 is not listed: the context switch and GMEM copy commands
+ * write VFD_PERFCOUNTER0_SELECT as a dummy register and would clobber it.
+ */
+static struct adreno_perfcount_register a3xx_perfcounters_vfd[] = {
+	{ KGSL_PERFCOUNTER_NOT_USED, 0, A3XX_RBBM_PERFCTR_VFD_1_LO,
+		A3XX_VFD_PERFCOUNTER1_SELECT },
+};
+
+static struct adreno_perfcount_register a3xx_perfcounters_hlsq[] = {
+	{ KGSL_PERFCOUNTER_NOT_USED, 0, A3XX_RBBM_PERFCTR_HLSQ_0_LO,
+		A3XX_HLSQ_PERFCOUNTER0_SELECT },
+	{ KGSL_PERFCOUNTER_NOT_USED, 0, A3XX_RBBM_PERFCTR_HLSQ_1_LO,
+		A3XX_HLSQ_PERFCOUNTER1_SELECT },
+	{ KGSL_PERFCOUNTER_NOT_USED, 0, A3XX_RBBM_PERFCTR_HLSQ_2_LO,
+		A3XX_HLSQ_PERFCOUNTER2_SELECT },
+	{ KGSL_PERFCOUNTER_NOT_USED, 0, A3XX_RBBM_PERFCTR_HLSQ_3_LO,
+		A3XX_HLSQ_PERFCOUNTER3_SELECT },
+	{ KGSL_PERFCOUNTER_NOT_USED, 0, A3XX_RBBM_PERFCTR_HLSQ_4_LO,
+		A3XX_HLSQ_PERFCOUNTER4_SELECT },
+	{ KGSL_PERFCOUNTER_NOT_USED, 0, A3XX_RBBM_PERFCTR_HLSQ_5_LO,
+		A3XX_HLSQ_PERFCOUNTER5_SELECT },
+};
+
+static struct adreno_perfcount_register a3xx_perfcounters_vpc[] = {
+	{ KGSL_PERFCOUNTER_NOT_USED, 0, A3XX_RBBM_PERFCTR_VPC_0_LO,
+		A3XX_VPC_PERFCOUNTER0_SELECT },
+	{ KGSL_PERFCOUNTER_NOT_USED, 0, A3XX_RBBM_PERFCTR_VPC_1_LO,
+		A3XX_VPC_PERFCOUNTER1_SELECT },
+};
+
+static struct adreno_perfcount_register a3xx_perfcounters_tse[] = {
+	{ KGSL_PERFCOUNTER_NOT_USED, 0, A3XX_RBBM_PERFCTR_TSE_0_LO,
+		A3XX_GRAS_PERFCOUNTER0_SELECT },
+	{ KGSL_PERFCOUNTER_NOT_USED, 0, A3XX_RBBM_PERFCTR_TSE_1_LO,
+		A3XX_GRAS_PERFCOUNTER1_SELECT },
+};
+
+static struct adreno_perfcount_register a3xx_perfcounters_ras[] = {
+	{ KGSL_PERFCOUNTER_NOT_USED, 0, A3XX_RBBM_PERFCTR_RAS_0_LO,
+		A3XX_GRAS_PERFCOUNTER2_SELECT },
+	{ KGSL_PERFCOUNTER_NOT_USED, 0, A3XX_RBBM_PERFCTR_RAS_1_LO,
+		A3XX_GRAS_PERFCOUNTER3_SELECT },
+};
+
+static struct adreno_perfcount_register a3xx_perfcounters_uche[] = {
+	{ KGSL_PERFCOUNTER_NOT_USED, 0, A3XX_RBBM_PERFCTR_UCHE_0_LO,
+		A3XX_UCHE_PERFCOUNTER0_SELECT },
+	{ KGSL_PERFCOUNTER_NOT_USED, 0, A3XX_RBBM_PERFCTR_UCHE_1_LO,
+		A3XX_UCHE_PERFCOUNTER1_SELECT },
+	{ KGSL_PERFCOUNTER_NOT_USED, 0, A3XX_RBBM_PERFCTR_UCHE_2_LO,
+		A3XX_UCHE_PERFCOUNTER2_SELECT },
+	{ KGSL_PERFCOUNTER_NOT_USED, 0, A3XX_RBBM_PERFCTR_UCHE_3_LO,
+		A3XX_UCHE_PERFCOUNTER3_SELECT },
+	{ KGSL_PERFCOUNTER_NOT_USED, 0, A3XX_RBBM_PERFCTR_UCHE_4_LO,
+		A3XX_UCHE_PERFCOUNTER4_SELECT },
+	{ KGSL_PERFCOUNTER_NOT_USED, 0, A3XX_RBBM_PERFCTR_UCHE_5_LO,
+		A3XX_UCHE_PERFCOUNTER5_SELECT },
+};
+
+static struct adreno_perfcount_register a3xx_perfcounters_tp[] = {
+	{ KGSL_PERFCOUNTER_NOT_USED, 0, A3XX_RBBM_PERFCTR_TP_0_LO,
+		A3XX_TP_PERFCOUNTER0_SELECT },
+	{ KGSL_PERFCOUNTER_NOT_USED, 0, A3XX_RBBM_PERFCTR_TP_1_LO,
+		A3XX_TP_PERFCOUNTER1_SELECT },
+	{ KGSL_PERFCOUNTER_NOT_USED, 0, A3XX_RBBM_PERFCTR_TP_2_LO,
+		A3XX_TP_PERFCOUNTER2_SELECT },
+	{ KGSL_PERFCOUNTER_NOT_USED, 0, A3XX_RBBM_PERFCTR_TP_3_LO,
+		A3XX_TP_PERFCOUNTER3_SELECT },
+	{ KGSL_PERFCOUNTER_NOT_USED, 0, A3XX_RBBM_PERFCTR_TP_4_LO,
+		A3XX_TP_PERFCOUNTER4_SELECT },
+	{ KGSL_PERFCOUNTER_NOT_USED, 0, A3XX_RBBM_PERFCTR_TP_5_LO,
+		A3XX_TP_PERFCOUNTER5_SELECT },
+};
+
+static struct adreno_perfcount_register a3xx_perfcounters_sp[] = {
+	{ KGSL_PERFCOUNTER_NOT_USED, 0, A3XX_RBBM_PERFCTR_SP_0_LO,
+		A3XX_SP_PERFCOUNTER0_SELECT },
+	{ KGSL_PERFCOUNTER_NOT_USED, 0, A3XX_RBBM_PERFCTR_SP_1_LO,
+		A3XX_SP_PERFCOUNTER1_SELECT },
+	{ KGSL_PERFCOUNTER_NOT_USED, 0, A3XX_RBBM_PERFCTR_SP_2_LO,
+		A3XX_SP_PERFCOUNTER2_SELECT },
+	{ KGSL_PERFCOUNTER_NOT_USED, 0, A3XX_RBBM_PERFCTR_SP_3_LO,
+		A3XX_SP_PERFCOUNTER3_SELECT },
+	{ KGSL_PERFCOUNTER_NOT_USED, 0, A3XX_RBBM_PERFCTR_SP_4_LO,
+		A3XX_SP_PERFCOUNTER4_SELECT },
+	{ KGSL_PERFCOUNTER_NOT_USED, 0, A3XX_RBBM_PERFCTR_SP_5_LO,
+		A3XX_SP_PERFCOUNTER5_SELECT },
+	{ KGSL_PERFCOUNTER_NOT_USED, 0, A3XX_RBBM_PERFCTR_SP_6_LO,
+		A3XX_SP_PERFCOUNTER6_SELECT },
+	{ KGSL_PERFCOUNTER_NOT_USED, 0, A3XX_RBBM_PERFCTR_SP_7_LO,
+		A3XX_SP_PERFCOUNTER7_SELECT },
+};
+
+static struct adreno_perfcount_register a3xx_perfcounters_rb[] = {
+	{ KGSL_PERFCOUNTER_NOT_USED, 0, A3XX_RBBM_PERFCTR_RB_0_LO,
+		A3XX_RB_PERFCOUNTER0_SELECT },
+	{ KGSL_PERFCOUNTER_NOT_USED, 0, A3XX_RBBM_PERFCTR_RB_1_LO,
+		A3XX_RB_PERFCOUNTER1_SELECT },
+};
 
-	/* Re-enable the counter */
-	reg &= ~RBBM_RBBM_CTL_RESET_PWR_CTR1;
-	reg |= RBBM_RBBM_CTL_ENABLE_PWR_CTR1;
-	adreno_regwrite(device, A3XX_RBBM_RBBM_CTL, reg);
+/*
+ * The power counters have no select register, the countable is the index
+ * of the counter. Counter 1 counts GPU busy cycles (see a3xx_start).
+ */
+static struct adreno_perfcount_register a3xx_perfcounters_pwr[] = {
+	{ 0, 0, A3XX_RBBM_PERFCTR_PWR_0_LO, 0 },
+	{ 1, 0, A3XX_RBBM_PERFCTR_PWR_1_LO, 0 },
+};
+
+#define A3XX_PERFCOUNTER_GROUP(name) { a3xx_perfcounters_##name, \
+	ARRAY_SIZE(a3xx_perfcounters_##name) }
+
+/* Indexed by the KGSL_PERFCOUNTER_GROUP_* ids */
+static struct adreno_perfcount_group a3xx_perfcounter_groups[] = {
+	A3XX_PERFCOUNTER_GROUP(cp),
+	A3XX_PERFCOUNTER_GROUP(rbbm),
+	A3XX_PERFCOUNTER_GROUP(pc),
+	A3XX_PERFCOUNTER_GROUP(vfd),
+	A3XX_PERFCOUNTER_GROUP(hlsq),
+	A3XX_PERFCOUNTER_GROUP(vpc),
+	A3XX_PERFCOUNTER_GROUP(tse),
+	A3XX_PERFCOUNTER_GROUP(ras),
+	A3XX_PERFCOUNTER_GROUP(uche),
+	A3XX_PERFCOUNTER_GROUP(tp),
+	A3XX_PERFCOUNTER_GROUP(sp),
+	A3XX_PERFCOUNTER_GROUP(rb),
+	A3XX_PERFCOUNTER_GROUP(pwr),
+};
+
+static struct adreno_perfcounters a3xx_perfcounters = {
+	a3xx_perfcounter_groups,
+	ARRAY_SIZE(a3xx_perfcounter_groups),
+};
 
-	return val;
+static void a3xx_perfcounter_enable(struct adreno_device *adreno_dev,
+	struct adreno_perfcount_register *reg)
+{
+	if (reg->select)
+		adreno_regwrite(&adreno_dev->dev, reg->select, reg->countable);
+}
+
+static uint64_t a3xx_perfcounter_read(struct adreno_device *adreno_dev,
+	struct adreno_perfcount_register *reg)
+{
+	struct kgsl_device *device = &adreno_dev->dev;
+	unsigned int lo, hi, tmp;
+
+	/* Re-read the high dword in case the low dword wrapped in between */
+	adreno_regread(device, reg->offset + 1, &hi);
+	do {
+		tmp = hi;
+		adreno_regread(device, reg->offset, &lo);
+		adreno_regread(device, reg->offset + 1, &hi);
+	} while (hi != tmp);
+
+	return (((uint64_t) hi) << 32) | lo;
 }
 
 static void a3xx_start(struct adreno_device *adreno_dev)
@@ -2740,8 +3081,14 @@ static void a3xx_start(struct adreno_device *adreno_dev)
 	/* Enable AHB error reporting */
 	adreno_regwrite(device, A3XX_RBBM_AHB_CTL1, 0xA6FFFFFF);
 
-	/* Turn on the power counters */
+	/* Reset the busy counter and turn on the power counters */
+	adreno_regwrite(device, A3XX_RBBM_RBBM_CTL,
+			RBBM_RBBM_CTL_RESET_PWR_CTR1);
 	adreno_regwrite(device, A3XX_RBBM_RBBM_CTL, 0x00030000);
+	a3xx_busy_prev = 0;
+
+	/* Turn on the performance counters */
+	adreno_regwrite(device, A3XX_RBBM_PERFCTR_CTL, RBBM_PERFCTR_CTL_ENABLE);
 
 	/* Turn on hang detection - this spews a lot of useful information
 	 * into the RBBM registers on a hang */
@@ -2774,4 +3121,8 @@ struct adreno_gpudev adreno_a3xx_gpudev = {
 	.busy_cycles = a3xx_busy_cycles,
 	.start = a3xx_start,
 	.snapshot = a3xx_snapshot,
+	.perfcounters = &a3xx_perfcounters,
+	.perfcounter_enable = a3xx_perfcounter_enable,
+	.perfcounter_read = a3xx_perfcounter_read,
+	.perfcounter_sample = a3xx_perfcounter_sample,
 };
@@ -220,6 +220,7 @@ void adreno_drawctxt_destroy(struct kgsl_device *device,
 
 	kgsl_sharedmem_free(&drawctxt->gpustate);
 	kgsl_sharedmem_free(&drawctxt->context_gmem_shadow.gmemshadow);
+	kgsl_sharedmem_free(&drawctxt->perf_samples);
 
 	kfree(drawctxt);
 	context->devctxt = NULL;
@@ -244,6 +245,67 @@ void adreno_drawctxt_set_bin_base_offset(struct kgsl_device *device,
 		drawctxt->bin_base_offset = offset;
 }
 
+static uint64_t perf_sample_read(struct kgsl_memdesc *memdesc,
+				unsigned int offset)
+{
+	unsigned int lo, hi;
+
+	kgsl_sharedmem_readl(memdesc, &lo, offset);
+	kgsl_sharedmem_readl(memdesc, &hi, offset + sizeof(unsigned int));
+
+	return (((uint64_t) hi) << 32) | lo;
+}
+
+/**
+ * adreno_drawctxt_perf_harvest - accumulate retired counter samples
+ * @adreno_dev - The 3D device that owns the context
+ * @drawctxt - the 3D context to harvest
+ *
+ * Add the counter deltas of every sample slot whose closing timestamp has
+ * retired to the running totals of the context and free the slots for
+ * reuse.  Must be called with the device mutex held.
+ */
+
+void adreno_drawctxt_perf_harvest(struct adreno_device *adreno_dev,
+				struct adreno_context *drawctxt)
+{
+	struct kgsl_device *device = &adreno_dev->dev;
+	unsigned int retired, slot, offset, i;
+	uint64_t start, end;
+
+	if (drawctxt->perf_samples.hostptr == NULL)
+		return;
+
+	retired = kgsl_readtimestamp(device, NULL, KGSL_TIMESTAMP_RETIRED);
+
+	/* Make sure the samples are read after the timestamp */
+	rmb();
+
+	while (drawctxt->perf_tail != drawctxt->perf_head) {
+		slot = drawctxt->perf_tail % ADRENO_CTX_PERF_SLOTS;
+
+		if (timestamp_cmp(retired, drawctxt->perf_timestamp[slot]) < 0)
+			break;
+
+		offset = slot * sizeof(struct adreno_ctx_perf_slot);
+
+		for (i = 0; i < ADRENO_CTX_PERFCOUNTERS; i++) {
+			start = perf_sample_read(&drawctxt->perf_samples,
+				offset + offsetof(struct adreno_ctx_perf_slot,
+					start[i]));
+			end = perf_sample_read(&drawctxt->perf_samples,
+				offset + offsetof(struct adreno_ctx_perf_slot,
+					end[i]));
+
+			/* The counters restart from zero after a power collapse */
+			if (end >= start)
+				drawctxt->perf_totals[i] += end - start;
+		}
+
+		drawctxt->perf_tail++;
+	}
+}
+
 /**
  * adreno_drawctxt_switch - switch the current draw context
  * @adreno_dev - The 3D device that owns the context
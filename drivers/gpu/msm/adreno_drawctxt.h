@@ -44,6 +44,19 @@
 #define CTXT_FLAGS_TRASHSTATE		0x00020000
 /* per context timestamps enabled */
 #define CTXT_FLAGS_PER_CONTEXT_TS	0x00040000
+/* performance counter sample is open for the resident context */
+#define CTXT_FLAGS_PERF_SAMPLE		0x00080000
+
+/* Counters sampled by the GPU on every switch into and out of a context */
+#define ADRENO_CTX_PERFCOUNTERS		3
+/* Number of samples that can be in flight for a single context */
+#define ADRENO_CTX_PERF_SLOTS		16
+
+enum adreno_ctx_perfcounter {
+	ADRENO_CTX_PERF_BUSY = 0,
+	ADRENO_CTX_PERF_ALU,
+	ADRENO_CTX_PERF_TEX,
+};
 
 struct kgsl_device;
 struct adreno_device;
@@ -105,6 +118,24 @@ struct adreno_context {
 	struct kgsl_memdesc constant_load_commands[3];
 	struct kgsl_memdesc cond_execs[4];
 	struct kgsl_memdesc hlsqcontrol_restore_commands[1];
+
+	/*
+	 * Performance counter samples. Each slot holds the counter values
+	 * at switch in and switch out, written by the GPU. The slot is
+	 * accumulated into perf_totals once perf_timestamp[slot] retires.
+	 */
+	struct kgsl_memdesc perf_samples;
+	unsigned int perf_head;
+	unsigned int perf_tail;
+	unsigned int perf_timestamp[ADRENO_CTX_PERF_SLOTS];
+	uint64_t perf_totals[ADRENO_CTX_PERFCOUNTERS];
+	unsigned int perf_dropped;
+};
+
+/* Layout of one slot in adreno_context.perf_samples */
+struct adreno_ctx_perf_slot {
+	uint64_t start[ADRENO_CTX_PERFCOUNTERS];
+	uint64_t end[ADRENO_CTX_PERFCOUNTERS];
 };
 
 int adreno_drawctxt_create(struct kgsl_device *device,
@@ -121,6 +152,8 @@ void adreno_drawctxt_switch(struct adreno_device *adreno_dev,
 void adreno_drawctxt_set_bin_base_offset(struct kgsl_device *device,
 					struct kgsl_context *context,
 					unsigned int offset);
+void adreno_drawctxt_perf_harvest(struct adreno_device *adreno_dev,
+				struct adreno_context *drawctxt);
 
 /* GPU context switch helper functions */
 
@@ -304,6 +304,7 @@ void kgsl_mem_entry_attach_process(struct kgsl_mem_entry *entry,
 	spin_unlock(&process->mem_lock);
 
 	entry->priv = process;
+	kgsl_process_charge_mm(process, entry->memtype, entry->memdesc.size);
 }
 
 /* Detach a memory entry from a process and unmap it from the MMU */
@@ -314,6 +315,8 @@ static void kgsl_mem_entry_detach_process(struct kgsl_mem_entry *entry)
 		return;
 
 	entry->priv->stats[entry->memtype].cur -= entry->memdesc.size;
+	kgsl_process_charge_mm(entry->priv, entry->memtype,
+			       -(long) entry->memdesc.size);
 	entry->priv = NULL;
 
 	kgsl_mmu_unmap(entry->memdesc.pagetable, &entry->memdesc);
@@ -718,6 +721,15 @@ kgsl_get_process_private(struct kgsl_device_private *cur_dev_priv)
 	private->pid = task_tgid_nr(current);
 	private->mem_rb = RB_ROOT;
 
+	/*
+	 * Hold the mm_struct (but not the address space) so that memory
+	 * freed after the process has exited can still be uncharged.
+	 */
+	if (current->mm) {
+		private->mm = current->mm;
+		atomic_inc(&private->mm->mm_count);
+	}
+
 	if (kgsl_mmu_enabled())
 	{
 		unsigned long pt_name;
@@ -725,6 +737,8 @@ kgsl_get_process_private(struct kgsl_device_private *cur_dev_priv)
 		pt_name = task_tgid_nr(current);
 		private->pagetable = kgsl_mmu_getpagetable(pt_name);
 		if (private->pagetable == NULL) {
+			if (private->mm)
+				mmdrop(private->mm);
 			kfree(private);
 			private = NULL;
 			goto out;
@@ -767,6 +781,8 @@ kgsl_put_process_private(struct kgsl_device *device,
 		kgsl_mem_entry_detach_process(entry);
 	}
 	kgsl_mmu_putpagetable(private->pagetable);
+	if (private->mm)
+		mmdrop(private->mm);
 	kfree(private);
 unlock:
 	mutex_unlock(&kgsl_driver.process_mutex);
@@ -804,6 +820,9 @@ static int kgsl_release(struct inode *inodep, struct file *filep)
 	 */
 	kgsl_cancel_events(device, dev_priv);
 
+	if (device->ftbl->release)
+		device->ftbl->release(dev_priv);
+
 	device->open_count--;
 	if (device->open_count == 0) {
 		result = device->ftbl->stop(device);
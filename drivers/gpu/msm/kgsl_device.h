@@ -111,6 +111,7 @@ struct kgsl_functable {
 	int (*setproperty) (struct kgsl_device *device,
 		enum kgsl_property_type type, void *value,
 		unsigned int sizebytes);
+	void (*release) (struct kgsl_device_private *dev_priv);
 };
 
 /* MH register values */
@@ -245,6 +246,7 @@ struct kgsl_process_private {
 	struct kgsl_pagetable *pagetable;
 	struct list_head list;
 	struct kobject kobj;
+	struct mm_struct *mm;
 
 	struct {
 		unsigned int cur;
@@ -272,6 +274,18 @@ static inline void kgsl_process_add_stats(struct kgsl_process_private *priv,
 		priv->stats[type].max = priv->stats[type].cur;
 }
 
+/*
+ * Charge (or uncharge, for a negative size) memory allocated by the driver
+ * on behalf of a process to that process's mm so that it is visible to the
+ * low memory killer.  Imported buffers are already charged elsewhere.
+ */
+static inline void kgsl_process_charge_mm(struct kgsl_process_private *priv,
+	unsigned int type, long size)
+{
+	if (priv->mm && type == KGSL_MEM_ENTRY_KERNEL)
+		add_mm_counter(priv->mm, MM_UNRECLAIMABLE, size >> PAGE_SHIFT);
+}
+
 static inline void kgsl_regread(struct kgsl_device *device,
 				unsigned int offsetwords,
 				unsigned int *value)
@@ -59,6 +59,55 @@ struct clk_pair clks[KGSL_MAX_CLKS] = {
 	},
 };
 
+/*
+ * Return the bus scale usecase to vote for the active power level,
+ * offset by any adjustment requested by the pwrscale policy.  The
+ * adjusted vote is kept within the range used by the active levels.
+ */
+static unsigned int kgsl_pwrctrl_bus_index(struct kgsl_pwrctrl *pwr)
+{
+	int index = pwr->pwrlevels[pwr->active_pwrlevel].bus_freq;
+	int lo, hi;
+
+	if (pwr->bus_mod == 0 || pwr->num_pwrlevels < 2)
+		return index;
+
+	lo = pwr->pwrlevels[pwr->num_pwrlevels - 2].bus_freq;
+	hi = pwr->pwrlevels[0].bus_freq;
+
+	index += pwr->bus_mod;
+	if (index < lo)
+		index = lo;
+	if (index > hi)
+		index = hi;
+	return index;
+}
+
+/*
+ * kgsl_pwrctrl_buslevel_update - bias the AXI vote for the active level
+ * @device: the device whose vote should change
+ * @mod: number of bus usecases to move up (positive) or down (negative)
+ *	 from the vote tied to the active power level
+ *
+ * Only bus scaling clients (pcl) support a bias; targets voting through
+ * ebi1_clk directly keep the vote tied to the power level.
+ */
+void kgsl_pwrctrl_buslevel_update(struct kgsl_device *device, int mod)
+{
+	struct kgsl_pwrctrl *pwr = &device->pwrctrl;
+	unsigned int old = kgsl_pwrctrl_bus_index(pwr);
+
+	if (!pwr->pcl)
+		return;
+
+	pwr->bus_mod = mod;
+	if (test_bit(KGSL_PWRFLAGS_AXI_ON, &pwr->power_flags) &&
+		kgsl_pwrctrl_bus_index(pwr) != old)
+		msm_bus_scale_client_update_request(pwr->pcl,
+			kgsl_pwrctrl_bus_index(pwr));
+}
+EXPORT_SYMBOL(kgsl_pwrctrl_buslevel_update);
+
 void kgsl_pwrctrl_pwrlevel_change(struct kgsl_device *device,
 				unsigned int new_level)
 {
@@ -71,6 +120,8 @@ void kgsl_pwrctrl_pwrlevel_change(struct kgsl_device *device,
 		int d = (diff > 0) ? 1 : -1;
 		int level = pwr->active_pwrlevel;
 		pwr->active_pwrlevel = new_level;
+		/* A bus bias only applies to the level it was requested at */
+		pwr->bus_mod = 0;
 		if ((test_bit(KGSL_PWRFLAGS_CLK_ON, &pwr->power_flags)) ||
 			(device->state == KGSL_STATE_NAP)) {
 			/*
@@ -93,7 +144,7 @@ void kgsl_pwrctrl_pwrlevel_change(struct kgsl_device *device,
 		if (test_bit(KGSL_PWRFLAGS_AXI_ON, &pwr->power_flags)) {
 			if (pwr->pcl)
 				msm_bus_scale_client_update_request(pwr->pcl,
-					pwrlevel->bus_freq);
+					kgsl_pwrctrl_bus_index(pwr));
 			else if (pwr->ebi1_clk)
 				clk_set_rate(pwr->ebi1_clk, pwrlevel->bus_freq);
 		}
@@ -441,8 +492,7 @@ void kgsl_pwrctrl_axi(struct kgsl_device *device, int state)
 			}
 			if (pwr->pcl)
 				msm_bus_scale_client_update_request(pwr->pcl,
-					pwr->pwrlevels[pwr->active_pwrlevel].
-						bus_freq);
+					kgsl_pwrctrl_bus_index(pwr));
 		}
 	}
 }
@@ -51,6 +51,7 @@ struct kgsl_pwrctrl {
 	bool strtstp_sleepwake;
 	struct regulator *gpu_reg;
 	uint32_t pcl;
+	int bus_mod;
 	unsigned int nap_allowed;
 	unsigned int idle_needed;
 	const char *irq_name;
@@ -70,6 +71,7 @@ int kgsl_pwrctrl_sleep(struct kgsl_device *device);
 void kgsl_pwrctrl_wake(struct kgsl_device *device);
 void kgsl_pwrctrl_pwrlevel_change(struct kgsl_device *device,
 	unsigned int level);
+void kgsl_pwrctrl_buslevel_update(struct kgsl_device *device, int mod);
 int kgsl_pwrctrl_init_sysfs(struct kgsl_device *device);
 void kgsl_pwrctrl_uninit_sysfs(struct kgsl_device *device);
 void kgsl_pwrctrl_enable(struct kgsl_device *device);
@@ -47,6 +47,9 @@ static struct kgsl_pwrscale_policy *kgsl_pwrscale_policies[] = {
 #endif
 #ifdef CONFIG_MSM_DCVS
 	&kgsl_pwrscale_policy_msm,
+#endif
+#ifdef CONFIG_MSM_KGSL_PWRSCALE_ONDEMAND
+	&kgsl_pwrscale_policy_ondemand,
 #endif
 	NULL
 };
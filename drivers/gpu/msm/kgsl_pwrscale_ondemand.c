@@ -0,0 +1,372 @@
+/* Copyright (c) 2012, Code Aurora Forum. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#include <linux/kernel.h>
+#include <linux/slab.h>
+#include <linux/math64.h>
+
+#include "kgsl.h"
+#include "kgsl_pwrscale.h"
+#include "kgsl_device.h"
+
+/*
+ * In-kernel GPU frequency governor.  Busy and total time reported by the
+ * device are accumulated over a sampling window; at the end of each
+ * window the load is compared against the up/down thresholds and the
+ * power level is moved by one step (or straight to the thermal limit if
+ * the GPU is saturated).  When bus biasing is enabled the AXI vote is
+ * raised by one usecase before the GPU clock, since a busy GPU at a low
+ * clock is frequently waiting on memory.
+ */
+
+#define ONDEMAND_UP_THRESHOLD		80
+#define ONDEMAND_DOWN_THRESHOLD		30
+#define ONDEMAND_TURBO_THRESHOLD	95
+#define ONDEMAND_SAMPLE_MS		50
+
+struct ondemand_priv {
+	unsigned int up_threshold;
+	unsigned int down_threshold;
+	unsigned int turbo_threshold;
+	unsigned int sample_ms;
+	unsigned int bus_bias;
+	s64 busy_time;
+	s64 total_time;
+	unsigned int load;
+	unsigned int up_cnt;
+	unsigned int down_cnt;
+	unsigned int bus_up_cnt;
+};
+
+static ssize_t ondemand_show_val(char *buf, unsigned int val)
+{
+	return snprintf(buf, PAGE_SIZE, "%u\n", val);
+}
+
+static int ondemand_parse_val(const char *buf, unsigned int max,
+			      unsigned int *val)
+{
+	unsigned long tmp;
+
+	if (strict_strtoul(buf, 0, &tmp) || tmp > max)
+		return -EINVAL;
+	*val = tmp;
+	return 0;
+}
+
+static ssize_t ondemand_up_threshold_show(struct kgsl_device *device,
+					  struct kgsl_pwrscale *pwrscale,
+					  char *buf)
+{
+	struct ondemand_priv *priv = pwrscale->priv;
+	return ondemand_show_val(buf, priv->up_threshold);
+}
+
+static ssize_t ondemand_up_threshold_store(struct kgsl_device *device,
+					   struct kgsl_pwrscale *pwrscale,
+					   const char *buf, size_t count)
+{
+	struct ondemand_priv *priv = pwrscale->priv;
+	unsigned int val;
+
+	if (ondemand_parse_val(buf, 100, &val))
+		return -EINVAL;
+
+	mutex_lock(&device->mutex);
+	if (val <= priv->down_threshold) {
+		mutex_unlock(&device->mutex);
+		return -EINVAL;
+	}
+	priv->up_threshold = val;
+	mutex_unlock(&device->mutex);
+	return count;
+}
+
+static ssize_t ondemand_down_threshold_show(struct kgsl_device *device,
+					    struct kgsl_pwrscale *pwrscale,
+					    char *buf)
+{
+	struct ondemand_priv *priv = pwrscale->priv;
+	return ondemand_show_val(buf, priv->down_threshold);
+}
+
+static ssize_t ondemand_down_threshold_store(struct kgsl_device *device,
+					     struct kgsl_pwrscale *pwrscale,
+					     const char *buf, size_t count)
+{
+	struct ondemand_priv *priv = pwrscale->priv;
+	unsigned int val;
+
+	if (ondemand_parse_val(buf, 100, &val))
+		return -EINVAL;
+
+	mutex_lock(&device->mutex);
+	if (val >= priv->up_threshold) {
+		mutex_unlock(&device->mutex);
+		return -EINVAL;
+	}
+	priv->down_threshold = val;
+	mutex_unlock(&device->mutex);
+	return count;
+}
+
+static ssize_t ondemand_turbo_threshold_show(struct kgsl_device *device,
+					     struct kgsl_pwrscale *pwrscale,
+					     char *buf)
+{
+	struct ondemand_priv *priv = pwrscale->priv;
+	return ondemand_show_val(buf, priv->turbo_threshold);
+}
+
+static ssize_t ondemand_turbo_threshold_store(struct kgsl_device *device,
+					      struct kgsl_pwrscale *pwrscale,
+					      const char *buf, size_t count)
+{
+	struct ondemand_priv *priv = pwrscale->priv;
+	unsigned int val;
+
+	/* Values above 100 disable the jump to the top level */
+	if (ondemand_parse_val(buf, 101, &val))
+		return -EINVAL;
+
+	mutex_lock(&device->mutex);
+	priv->turbo_threshold = val;
+	mutex_unlock(&device->mutex);
+	return count;
+}
+
+static ssize_t ondemand_sample_ms_show(struct kgsl_device *device,
+				       struct kgsl_pwrscale *pwrscale,
+				       char *buf)
+{
+	struct ondemand_priv *priv = pwrscale->priv;
+	return ondemand_show_val(buf, priv->sample_ms);
+}
+
+static ssize_t ondemand_sample_ms_store(struct kgsl_device *device,
+					struct kgsl_pwrscale *pwrscale,
+					const char *buf, size_t count)
+{
+	struct ondemand_priv *priv = pwrscale->priv;
+	unsigned int val;
+
+	if (ondemand_parse_val(buf, 1000, &val) || val == 0)
+		return -EINVAL;
+
+	mutex_lock(&device->mutex);
+	priv->sample_ms = val;
+	priv->busy_time = 0;
+	priv->total_time = 0;
+	mutex_unlock(&device->mutex);
+	return count;
+}
+
+static ssize_t ondemand_bus_bias_show(struct kgsl_device *device,
+				      struct kgsl_pwrscale *pwrscale,
+				      char *buf)
+{
+	struct ondemand_priv *priv = pwrscale->priv;
+	return ondemand_show_val(buf, priv->bus_bias);
+}
+
+static ssize_t ondemand_bus_bias_store(struct kgsl_device *device,
+				       struct kgsl_pwrscale *pwrscale,
+				       const char *buf, size_t count)
+{
+	struct ondemand_priv *priv = pwrscale->priv;
+	unsigned int val;
+
+	if (ondemand_parse_val(buf, 1, &val))
+		return -EINVAL;
+
+	mutex_lock(&device->mutex);
+	priv->bus_bias = val;
+	if (!val)
+		kgsl_pwrctrl_buslevel_update(device, 0);
+	mutex_unlock(&device->mutex);
+	return count;
+}
+
+static ssize_t ondemand_stats_show(struct kgsl_device *device,
+				   struct kgsl_pwrscale *pwrscale,
+				   char *buf)
+{
+	struct ondemand_priv *priv = pwrscale->priv;
+
+	return snprintf(buf, PAGE_SIZE,
+		"load: %u\nlevel: %u\nbus_mod: %d\nup: %u\ndown: %u\n"
+		"bus_up: %u\n", priv->load, device->pwrctrl.active_pwrlevel,
+		device->pwrctrl.bus_mod, priv->up_cnt, priv->down_cnt,
+		priv->bus_up_cnt);
+}
+
+PWRSCALE_POLICY_ATTR(up_threshold, 0644, ondemand_up_threshold_show,
+		     ondemand_up_threshold_store);
+PWRSCALE_POLICY_ATTR(down_threshold, 0644, ondemand_down_threshold_show,
+		     ondemand_down_threshold_store);
+PWRSCALE_POLICY_ATTR(turbo_threshold, 0644, ondemand_turbo_threshold_show,
+		     ondemand_turbo_threshold_store);
+PWRSCALE_POLICY_ATTR(sample_ms, 0644, ondemand_sample_ms_show,
+		     ondemand_sample_ms_store);
+PWRSCALE_POLICY_ATTR(bus_bias, 0644, ondemand_bus_bias_show,
+		     ondemand_bus_bias_store);
+PWRSCALE_POLICY_ATTR(stats, 0444, ondemand_stats_show, NULL);
+
+static struct attribute *ondemand_attrs[] = {
+	&policy_attr_up_threshold.attr,
+	&policy_attr_down_threshold.attr,
+	&policy_attr_turbo_threshold.attr,
+	&policy_attr_sample_ms.attr,
+	&policy_attr_bus_bias.attr,
+	&policy_attr_stats.attr,
+	NULL
+};
+
+static struct attribute_group ondemand_attr_group = {
+	.attrs = ondemand_attrs,
+};
+
+static void ondemand_scale_up(struct kgsl_device *device,
+			      struct ondemand_priv *priv)
+{
+	struct kgsl_pwrctrl *pwr = &device->pwrctrl;
+
+	if (pwr->active_pwrlevel <= pwr->thermal_pwrlevel)
+		return;
+
+	if (priv->load >= priv->turbo_threshold) {
+		kgsl_pwrctrl_pwrlevel_change(device, pwr->thermal_pwrlevel);
+		priv->up_cnt++;
+		return;
+	}
+
+	/* Try a faster bus at the current clock before raising the clock */
+	if (priv->bus_bias && pwr->pcl && pwr->bus_mod == 0 &&
+		pwr->pwrlevels[pwr->active_pwrlevel - 1].bus_freq >
+		pwr->pwrlevels[pwr->active_pwrlevel].bus_freq) {
+		kgsl_pwrctrl_buslevel_update(device, 1);
+		priv->bus_up_cnt++;
+		return;
+	}
+
+	kgsl_pwrctrl_pwrlevel_change(device, pwr->active_pwrlevel - 1);
+	priv->up_cnt++;
+}
+
+static void ondemand_scale_down(struct kgsl_device *device,
+				struct ondemand_priv *priv)
+{
+	struct kgsl_pwrctrl *pwr = &device->pwrctrl;
+
+	/* Drop any bus bias before lowering the clock */
+	if (pwr->bus_mod > 0) {
+		kgsl_pwrctrl_buslevel_update(device, 0);
+		return;
+	}
+
+	if (pwr->active_pwrlevel >= pwr->num_pwrlevels - 2)
+		return;
+
+	kgsl_pwrctrl_pwrlevel_change(device, pwr->active_pwrlevel + 1);
+	priv->down_cnt++;
+}
+
+static void ondemand_idle(struct kgsl_device *device,
+			  struct kgsl_pwrscale *pwrscale)
+{
+	struct ondemand_priv *priv = pwrscale->priv;
+	struct kgsl_power_stats stats;
+
+	device->ftbl->power_stats(device, &stats);
+	if (stats.total_time <= 0)
+		return;
+
+	priv->busy_time += stats.busy_time;
+	priv->total_time += stats.total_time;
+
+	if (priv->total_time < (s64) priv->sample_ms * USEC_PER_MSEC)
+		return;
+
+	if (priv->busy_time > priv->total_time)
+		priv->busy_time = priv->total_time;
+
+	priv->load = div64_u64((u64) priv->busy_time * 100,
+			       (u64) priv->total_time);
+	priv->busy_time = 0;
+	priv->total_time = 0;
+
+	if (priv->load >= priv->up_threshold)
+		ondemand_scale_up(device, priv);
+	else if (priv->load < priv->down_threshold)
+		ondemand_scale_down(device, priv);
+}
+
+static void ondemand_wake(struct kgsl_device *device,
+			  struct kgsl_pwrscale *pwrscale)
+{
+	struct ondemand_priv *priv = pwrscale->priv;
+
+	priv->busy_time = 0;
+	priv->total_time = 0;
+
+	if (device->state != KGSL_STATE_NAP)
+		kgsl_pwrctrl_pwrlevel_change(device,
+					device->pwrctrl.default_pwrlevel);
+}
+
+static void ondemand_sleep(struct kgsl_device *device,
+			   struct kgsl_pwrscale *pwrscale)
+{
+	kgsl_pwrctrl_buslevel_update(device, 0);
+}
+
+static int ondemand_init(struct kgsl_device *device,
+			 struct kgsl_pwrscale *pwrscale)
+{
+	struct ondemand_priv *priv;
+
+	priv = pwrscale->priv = kzalloc(sizeof(struct ondemand_priv),
+					GFP_KERNEL);
+	if (pwrscale->priv == NULL)
+		return -ENOMEM;
+
+	priv->up_threshold = ONDEMAND_UP_THRESHOLD;
+	priv->down_threshold = ONDEMAND_DOWN_THRESHOLD;
+	priv->turbo_threshold = ONDEMAND_TURBO_THRESHOLD;
+	priv->sample_ms = ONDEMAND_SAMPLE_MS;
+	priv->bus_bias = 1;
+
+	kgsl_pwrscale_policy_add_files(device, pwrscale, &ondemand_attr_group);
+
+	return 0;
+}
+
+static void ondemand_close(struct kgsl_device *device,
+			   struct kgsl_pwrscale *pwrscale)
+{
+	kgsl_pwrctrl_buslevel_update(device, 0);
+	kgsl_pwrscale_policy_remove_files(device, pwrscale,
+					  &ondemand_attr_group);
+	kfree(pwrscale->priv);
+	pwrscale->priv = NULL;
+}
+
+struct kgsl_pwrscale_policy kgsl_pwrscale_policy_ondemand = {
+	.name = "ondemand",
+	.init = ondemand_init,
+	.idle = ondemand_idle,
+	.sleep = ondemand_sleep,
+	.wake = ondemand_wake,
+	.close = ondemand_close
+};
+EXPORT_SYMBOL(kgsl_pwrscale_policy_ondemand);
@@ -31,6 +31,7 @@
 #include "msm_actuator.h"
 #include "msm_vfe32.h"
 #include "msm_camera_eeprom.h"
+#include "msm_camera_trace.h"
 
 #define MSM_MAX_CAMERA_SENSORS 5
 
@@ -1176,6 +1177,11 @@ static int msm_camera_v4l2_dqbuf(struct file *f, void *pctx,
 
 	rc = vb2_dqbuf(&pcam_inst->vid_bufq, pb,  f->f_flags & O_NONBLOCK);
 	D("%s, videobuf_dqbuf returns %d\n", __func__, rc);
+	if (!rc) {
+		trace_msm_cam_dqbuf(pb->sequence, pcam_inst->image_mode,
+			pb->index);
+		msm_cam_latency_mark(MSM_CAM_LAT_DQBUF, pb->sequence);
+	}
 
 	mutex_unlock(&pcam_inst->inst_lock);
 	return rc;
@@ -1246,6 +1252,8 @@ static int msm_camera_v4l2_streamoff(struct file *f, void *pctx,
 		rc = msm_server_streamoff(pcam, pcam_inst->my_index);
 	if (rc < 0)
 		pr_err("%s: hw failed to stop streaming\n", __func__);
+	if (pcam_inst->vbqueue_initialized)
+		msm_mctl_zsl_flush(pcam_inst);
 
 	/* stop buffer streaming */
 	rc = vb2_streamoff(&pcam_inst->vid_bufq, buf_type);
@@ -2228,8 +2236,10 @@ static int msm_close(struct file *f)
 	pcam_inst->streamon = 0;
 	pcam->use_count--;
 	pcam->dev_inst_map[pcam_inst->image_mode] = NULL;
-	if (pcam_inst->vbqueue_initialized)
+	if (pcam_inst->vbqueue_initialized) {
+		msm_mctl_zsl_flush(pcam_inst);
 		vb2_queue_release(&pcam_inst->vid_bufq);
+	}
 	D("%s Closing down instance %p ", __func__, pcam_inst);
 	D("%s index %d nodeid %d count %d\n", __func__, pcam_inst->my_index,
 		pcam->vnode_id, pcam->use_count);
@@ -338,6 +338,10 @@ struct msm_cam_v4l2_dev_inst {
 	struct img_plane_info plane_info;
 	int vbqueue_initialized;
     struct mutex inst_lock;
+	/* zero shutter lag ring, protected by vq_irqlock */
+	struct list_head zsl_ring;
+	int zsl_depth;
+	int zsl_count;
 };
 
 struct msm_cam_mctl_node {
@@ -484,6 +488,17 @@ int msm_mctl_init(struct msm_cam_v4l2_device *pcam);
 int msm_mctl_free(struct msm_cam_v4l2_device *pcam);
 int msm_mctl_buf_init(struct msm_cam_v4l2_device *pcam);
 int msm_mctl_init_user_formats(struct msm_cam_v4l2_device *pcam);
+/* per-frame latency tracking, see msm_camera_trace.c */
+enum msm_cam_latency_stage {
+	MSM_CAM_LAT_SOF,
+	MSM_CAM_LAT_VFE_OUT,
+	MSM_CAM_LAT_BUF_DONE,
+	MSM_CAM_LAT_DQBUF,
+	MSM_CAM_LAT_MAX,
+};
+void msm_cam_latency_mark(enum msm_cam_latency_stage stage,
+	uint32_t frame_id);
+
 int msm_mctl_buf_done(struct msm_cam_media_controller *pmctl,
 			int msg_type, struct msm_free_buf *buf,
 			uint32_t frame_id);
@@ -495,6 +510,11 @@ int msm_mctl_reserve_free_buf(struct msm_cam_media_controller *pmctl,
 int msm_mctl_release_free_buf(struct msm_cam_media_controller *pmctl,
 				struct msm_cam_v4l2_dev_inst *pcam_inst,
 				int path, struct msm_free_buf *free_buf);
+int msm_mctl_zsl_config(struct msm_cam_media_controller *pmctl,
+				void __user *arg);
+int msm_mctl_zsl_claim(struct msm_cam_media_controller *pmctl,
+				void __user *arg);
+void msm_mctl_zsl_flush(struct msm_cam_v4l2_dev_inst *pcam_inst);
 /*Memory(PMEM) functions*/
 int msm_register_pmem(struct hlist_head *ptype, void __user *arg,
 				struct ion_client *client);
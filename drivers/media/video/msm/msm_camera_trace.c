@@ -0,0 +1,153 @@
+/* Copyright (c) 2012, Code Aurora Forum. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#include <linux/module.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/spinlock.h>
+#include <linux/ktime.h>
+#include <linux/uaccess.h>
+
+#include "msm.h"
+
+/* Instantiate tracepoints */
+#define CREATE_TRACE_POINTS
+#include "msm_camera_trace.h"
+
+/*
+ * Stage latency histogram. Timestamps of the last few frames are kept by
+ * frame id; each stage is measured from the first time the previous
+ * stage was reached for the same frame, so with several outputs per
+ * frame the later ones include the time spent on the earlier ones.
+ * Bucket n counts latencies of [2^(n-1), 2^n) microseconds.
+ */
+#define MSM_CAM_LAT_SLOTS	16
+#define MSM_CAM_LAT_BUCKETS	20
+
+struct msm_cam_latency_slot {
+	uint32_t frame_id;
+	ktime_t ts[MSM_CAM_LAT_MAX];
+};
+
+static struct msm_cam_latency_slot latency_slot[MSM_CAM_LAT_SLOTS];
+/* row 0 holds the SOF to DQBUF total, row n the stage n-1 to n time */
+static uint32_t latency_hist[MSM_CAM_LAT_MAX][MSM_CAM_LAT_BUCKETS];
+static DEFINE_SPINLOCK(latency_lock);
+
+static const char * const latency_name[MSM_CAM_LAT_MAX] = {
+	"sof-dqbuf", "sof-vfe", "vfe-done", "done-dqbuf",
+};
+
+static void msm_cam_latency_add(int row, ktime_t start, ktime_t end)
+{
+	s64 us = ktime_to_us(ktime_sub(end, start));
+	int bucket;
+
+	if (us < 0)
+		return;
+	bucket = us > INT_MAX ? MSM_CAM_LAT_BUCKETS - 1 : fls((int)us);
+	if (bucket >= MSM_CAM_LAT_BUCKETS)
+		bucket = MSM_CAM_LAT_BUCKETS - 1;
+	latency_hist[row][bucket]++;
+}
+
+void msm_cam_latency_mark(enum msm_cam_latency_stage stage,
+	uint32_t frame_id)
+{
+	struct msm_cam_latency_slot *slot;
+	ktime_t now = ktime_get();
+	unsigned long flags;
+
+	slot = &latency_slot[frame_id % MSM_CAM_LAT_SLOTS];
+	spin_lock_irqsave(&latency_lock, flags);
+	if (stage == MSM_CAM_LAT_SOF) {
+		memset(slot, 0, sizeof(*slot));
+		slot->frame_id = frame_id;
+		slot->ts[MSM_CAM_LAT_SOF] = now;
+		goto out;
+	}
+	if (slot->frame_id != frame_id || !slot->ts[MSM_CAM_LAT_SOF].tv64)
+		goto out;
+	if (slot->ts[stage - 1].tv64)
+		msm_cam_latency_add(stage, slot->ts[stage - 1], now);
+	if (stage == MSM_CAM_LAT_DQBUF)
+		msm_cam_latency_add(0, slot->ts[MSM_CAM_LAT_SOF], now);
+	if (!slot->ts[stage].tv64)
+		slot->ts[stage] = now;
+out:
+	spin_unlock_irqrestore(&latency_lock, flags);
+}
+
+static int msm_cam_latency_show(struct seq_file *s, void *unused)
+{
+	uint32_t hist[MSM_CAM_LAT_MAX][MSM_CAM_LAT_BUCKETS];
+	unsigned long flags;
+	int i, j;
+
+	spin_lock_irqsave(&latency_lock, flags);
+	memcpy(hist, latency_hist, sizeof(hist));
+	spin_unlock_irqrestore(&latency_lock, flags);
+
+	seq_printf(s, "%10s", "<us");
+	for (j = 0; j < MSM_CAM_LAT_MAX; j++)
+		seq_printf(s, " %10s", latency_name[j]);
+	seq_printf(s, "\n");
+	for (i = 0; i < MSM_CAM_LAT_BUCKETS; i++) {
+		if (i == MSM_CAM_LAT_BUCKETS - 1)
+			seq_printf(s, "%10s", "inf");
+		else
+			seq_printf(s, "%10u", 1U << i);
+		for (j = 0; j < MSM_CAM_LAT_MAX; j++)
+			seq_printf(s, " %10u", hist[j][i]);
+		seq_printf(s, "\n");
+	}
+	return 0;
+}
+
+static int msm_cam_latency_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, msm_cam_latency_show, inode->i_private);
+}
+
+/* any write clears the histogram */
+static ssize_t msm_cam_latency_write(struct file *file,
+	const char __user *buf, size_t count, loff_t *ppos)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&latency_lock, flags);
+	memset(latency_hist, 0, sizeof(latency_hist));
+	spin_unlock_irqrestore(&latency_lock, flags);
+	return count;
+}
+
+static const struct file_operations msm_cam_latency_fops = {
+	.open = msm_cam_latency_open,
+	.read = seq_read,
+	.write = msm_cam_latency_write,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+static int __init msm_cam_latency_init(void)
+{
+	struct dentry *dent;
+
+	dent = debugfs_create_dir("msm_camera", NULL);
+	if (IS_ERR_OR_NULL(dent))
+		return 0;
+	debugfs_create_file("latency_hist", S_IRUGO | S_IWUSR, dent,
+		NULL, &msm_cam_latency_fops);
+	return 0;
+}
+module_init(msm_cam_latency_init);
@@ -0,0 +1,110 @@
+/* Copyright (c) 2012, Code Aurora Forum. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#if !defined(_MSM_CAMERA_TRACE_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _MSM_CAMERA_TRACE_H
+
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM msm_camera
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE msm_camera_trace
+
+#include <linux/tracepoint.h>
+
+/*
+ * Tracepoint for the VFE start of frame interrupt
+ */
+TRACE_EVENT(msm_cam_sof,
+
+	TP_PROTO(uint32_t frame_id),
+
+	TP_ARGS(frame_id),
+
+	TP_STRUCT__entry(
+		__field(uint32_t, frame_id)
+	),
+
+	TP_fast_assign(
+		__entry->frame_id = frame_id;
+	),
+
+	TP_printk("frame_id=%u", __entry->frame_id)
+);
+
+/*
+ * Tracepoint for a VFE write master finishing an output frame
+ */
+TRACE_EVENT(msm_cam_vfe_out,
+
+	TP_PROTO(uint32_t frame_id, int msg_id),
+
+	TP_ARGS(frame_id, msg_id),
+
+	TP_STRUCT__entry(
+		__field(uint32_t, frame_id)
+		__field(int, msg_id)
+	),
+
+	TP_fast_assign(
+		__entry->frame_id = frame_id;
+		__entry->msg_id = msg_id;
+	),
+
+	TP_printk("frame_id=%u msg_id=%d", __entry->frame_id,
+		__entry->msg_id)
+);
+
+DECLARE_EVENT_CLASS(msm_cam_buf_template,
+
+	TP_PROTO(uint32_t frame_id, int image_mode, uint32_t index),
+
+	TP_ARGS(frame_id, image_mode, index),
+
+	TP_STRUCT__entry(
+		__field(uint32_t, frame_id)
+		__field(int, image_mode)
+		__field(uint32_t, index)
+	),
+
+	TP_fast_assign(
+		__entry->frame_id = frame_id;
+		__entry->image_mode = image_mode;
+		__entry->index = index;
+	),
+
+	TP_printk("frame_id=%u image_mode=%d index=%u",
+		__entry->frame_id, __entry->image_mode, __entry->index)
+);
+
+/*
+ * Tracepoint for the media controller completing a frame
+ */
+DEFINE_EVENT(msm_cam_buf_template, msm_cam_buf_done,
+	TP_PROTO(uint32_t frame_id, int image_mode, uint32_t index),
+	TP_ARGS(frame_id, image_mode, index)
+);
+
+/*
+ * Tracepoint for userspace dequeuing a frame
+ */
+DEFINE_EVENT(msm_cam_buf_template, msm_cam_dqbuf,
+	TP_PROTO(uint32_t frame_id, int image_mode, uint32_t index),
+	TP_ARGS(frame_id, image_mode, index)
+);
+
+#endif /* _MSM_CAMERA_TRACE_H */
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
@@ -353,6 +353,14 @@ static int msm_mctl_cmd(struct msm_cam_media_controller *p_mctl,
 		break;
 	}
 
+	case MSM_CAM_IOCTL_ZSL_CFG:
+		rc = msm_mctl_zsl_config(p_mctl, argp);
+		break;
+
+	case MSM_CAM_IOCTL_ZSL_CLAIM:
+		rc = msm_mctl_zsl_claim(p_mctl, argp);
+		break;
+
 	case MSM_CAM_IOCTL_GET_KERNEL_SYSTEM_TIME: {
 		struct timeval timestamp;
 		if (copy_from_user(&timestamp, argp, sizeof(timestamp))) {
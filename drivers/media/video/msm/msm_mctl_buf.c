@@ -18,6 +18,7 @@
 #include <linux/spinlock.h>
 #include <linux/videodev2.h>
 #include <linux/vmalloc.h>
+#include <linux/uaccess.h>
 
 #include <media/v4l2-dev.h>
 #include <media/v4l2-ioctl.h>
@@ -27,6 +28,7 @@
 
 #include "msm.h"
 #include "msm_ispif.h"
+#include "msm_camera_trace.h"
 
 #ifdef CONFIG_MSM_CAMERA_DEBUG
 #define D(fmt, args...) pr_debug("msm_mctl_buf: " fmt, ##args)
@@ -321,6 +323,8 @@ static int msm_vbqueue_init(struct msm_cam_v4l2_dev_inst *pcam_inst,
 
 	spin_lock_init(&pcam_inst->vq_irqlock);
 	INIT_LIST_HEAD(&pcam_inst->free_vq);
+	INIT_LIST_HEAD(&pcam_inst->zsl_ring);
+	pcam_inst->zsl_count = 0;
 	videobuf2_queue_pmem_contig_init(q, type,
 					&msm_vb2_ops,
 					sizeof(struct msm_frame_buffer),
@@ -395,6 +399,156 @@ struct msm_frame_buffer *msm_mctl_buf_find(
 	return NULL;
 }
 
+/*
+ * Zero shutter lag: with a ZSL depth set on an instance, frames written
+ * by the VFE are held in a ring instead of being handed to userspace.
+ * Once the ring is full the oldest frame goes straight back on free_vq
+ * for the VFE to overwrite, so nothing is copied. Userspace picks the
+ * frame closest to the shutter press with MSM_CAM_IOCTL_ZSL_CLAIM,
+ * which completes that one buffer through vb2 for a normal DQBUF.
+ */
+#define MSM_ZSL_VFE_BUFS 2
+
+static int msm_mctl_zsl_hold(struct msm_cam_v4l2_dev_inst *pcam_inst,
+				struct msm_frame_buffer *buf)
+{
+	struct msm_frame_buffer *oldest;
+	unsigned long flags;
+	int limit;
+
+	spin_lock_irqsave(&pcam_inst->vq_irqlock, flags);
+	/* always leave the VFE its ping-pong pair to write into */
+	limit = min_t(int, pcam_inst->zsl_depth,
+		(int)pcam_inst->vid_bufq.num_buffers - MSM_ZSL_VFE_BUFS);
+	if (limit <= 0) {
+		spin_unlock_irqrestore(&pcam_inst->vq_irqlock, flags);
+		return 0;
+	}
+	list_add_tail(&buf->list, &pcam_inst->zsl_ring);
+	pcam_inst->zsl_count++;
+	while (pcam_inst->zsl_count > limit) {
+		oldest = list_first_entry(&pcam_inst->zsl_ring,
+					struct msm_frame_buffer, list);
+		oldest->state = MSM_BUFFER_STATE_QUEUED;
+		list_move_tail(&oldest->list, &pcam_inst->free_vq);
+		pcam_inst->zsl_count--;
+	}
+	spin_unlock_irqrestore(&pcam_inst->vq_irqlock, flags);
+	D("%s: holding buf idx %d, ring %d/%d\n", __func__,
+		buf->vidbuf.v4l2_buf.index, pcam_inst->zsl_count, limit);
+	return 1;
+}
+
+void msm_mctl_zsl_flush(struct msm_cam_v4l2_dev_inst *pcam_inst)
+{
+	struct msm_frame_buffer *buf, *tmp;
+	unsigned long flags;
+
+	spin_lock_irqsave(&pcam_inst->vq_irqlock, flags);
+	list_for_each_entry_safe(buf, tmp, &pcam_inst->zsl_ring, list) {
+		buf->state = MSM_BUFFER_STATE_QUEUED;
+		list_move_tail(&buf->list, &pcam_inst->free_vq);
+	}
+	pcam_inst->zsl_count = 0;
+	spin_unlock_irqrestore(&pcam_inst->vq_irqlock, flags);
+}
+
+static struct msm_cam_v4l2_dev_inst *msm_mctl_zsl_inst(
+	struct msm_cam_media_controller *pmctl, int image_mode)
+{
+	struct msm_cam_v4l2_dev_inst *pcam_inst;
+	int idx;
+
+	if (image_mode < 0 || image_mode >= MSM_MAX_IMG_MODE)
+		return NULL;
+	idx = msm_mctl_img_mode_to_inst_index(pmctl, image_mode, 0);
+	if (idx < 0)
+		return NULL;
+	pcam_inst = pmctl->pcam_ptr->dev_inst[idx];
+	if (!pcam_inst || !pcam_inst->vbqueue_initialized)
+		return NULL;
+	return pcam_inst;
+}
+
+int msm_mctl_zsl_config(struct msm_cam_media_controller *pmctl,
+			void __user *arg)
+{
+	struct msm_cam_zsl_cfg cfg;
+	struct msm_cam_v4l2_dev_inst *pcam_inst;
+	unsigned long flags;
+
+	if (copy_from_user(&cfg, arg, sizeof(cfg)))
+		return -EFAULT;
+	if (cfg.depth > MSM_ZSL_MAX_DEPTH)
+		return -EINVAL;
+	pcam_inst = msm_mctl_zsl_inst(pmctl, cfg.image_mode);
+	if (!pcam_inst) {
+		pr_err("%s: no instance for image mode %d\n",
+			__func__, cfg.image_mode);
+		return -EINVAL;
+	}
+	spin_lock_irqsave(&pcam_inst->vq_irqlock, flags);
+	pcam_inst->zsl_depth = cfg.depth;
+	spin_unlock_irqrestore(&pcam_inst->vq_irqlock, flags);
+	if (!cfg.depth)
+		msm_mctl_zsl_flush(pcam_inst);
+	D("%s: image mode %d zsl depth %d\n", __func__,
+		cfg.image_mode, cfg.depth);
+	return 0;
+}
+
+int msm_mctl_zsl_claim(struct msm_cam_media_controller *pmctl,
+			void __user *arg)
+{
+	struct msm_cam_zsl_claim claim;
+	struct msm_cam_v4l2_dev_inst *pcam_inst;
+	struct msm_frame_buffer *buf, *best = NULL;
+	s64 target, delta, best_delta = 0;
+	unsigned long flags;
+
+	if (copy_from_user(&claim, arg, sizeof(claim)))
+		return -EFAULT;
+	pcam_inst = msm_mctl_zsl_inst(pmctl, claim.image_mode);
+	if (!pcam_inst) {
+		pr_err("%s: no instance for image mode %d\n",
+			__func__, claim.image_mode);
+		return -EINVAL;
+	}
+	target = claim.timestamp;
+
+	spin_lock_irqsave(&pcam_inst->vq_irqlock, flags);
+	list_for_each_entry(buf, &pcam_inst->zsl_ring, list) {
+		if (!target) {
+			/* ring is oldest first, so this ends on the newest */
+			best = buf;
+			continue;
+		}
+		delta = abs64(timeval_to_ns(
+			&buf->vidbuf.v4l2_buf.timestamp) - target);
+		if (!best || delta < best_delta) {
+			best = buf;
+			best_delta = delta;
+		}
+	}
+	if (best) {
+		list_del_init(&best->list);
+		pcam_inst->zsl_count--;
+	}
+	spin_unlock_irqrestore(&pcam_inst->vq_irqlock, flags);
+	if (!best)
+		return -EAGAIN;
+
+	claim.timestamp = timeval_to_ns(&best->vidbuf.v4l2_buf.timestamp);
+	claim.frame_id = best->vidbuf.v4l2_buf.sequence;
+	claim.index = best->vidbuf.v4l2_buf.index;
+	vb2_buffer_done(&best->vidbuf, VB2_BUF_STATE_DONE);
+	D("%s: claimed buf idx %d frame %d\n", __func__,
+		claim.index, claim.frame_id);
+	if (copy_to_user(arg, &claim, sizeof(claim)))
+		return -EFAULT;
+	return 0;
+}
+
 int msm_mctl_buf_done_proc(
 		struct msm_cam_media_controller *pmctl,
 		struct msm_cam_v4l2_dev_inst *pcam_inst,
@@ -417,6 +571,14 @@ int msm_mctl_buf_done_proc(
 		msm_mctl_gettimeofday(
 			&buf->vidbuf.v4l2_buf.timestamp);
 	}
+	trace_msm_cam_buf_done(buf->vidbuf.v4l2_buf.sequence, image_mode,
+		buf->vidbuf.v4l2_buf.index);
+	msm_cam_latency_mark(MSM_CAM_LAT_BUF_DONE,
+		buf->vidbuf.v4l2_buf.sequence);
+	if (gen_timestamp) {
+		if (msm_mctl_zsl_hold(pcam_inst, buf))
+			return 0;
+	}
 	vb2_buffer_done(&buf->vidbuf, VB2_BUF_STATE_DONE);
 	return 0;
 }
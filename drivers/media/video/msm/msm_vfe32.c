@@ -30,6 +30,7 @@
 
 #include "msm.h"
 #include "msm_vfe32.h"
+#include "msm_camera_trace.h"
 
 atomic_t irq_cnt;
 
@@ -3001,6 +3002,8 @@ static void vfe32_process_camif_sof_irq(void)
 		return;
 	}
 	vfe32_ctrl->vfeFrameId++;
+	trace_msm_cam_sof(vfe32_ctrl->vfeFrameId);
+	msm_cam_latency_mark(MSM_CAM_LAT_SOF, vfe32_ctrl->vfeFrameId);
 	vfe32_send_isp_msg(vfe32_ctrl, MSG_ID_SOF_ACK);
 	CDBG("camif_sof_irq, frameId = %d\n", vfe32_ctrl->vfeFrameId);
 
@@ -3107,6 +3110,8 @@ static void vfe_send_outmsg(struct v4l2_subdev *sd, uint8_t msgid,
 	msg.buf.ch_paddr[1]	= ch1_paddr;
 	msg.buf.ch_paddr[2]	= ch2_paddr;
 	msg.frameCounter = vfe32_ctrl->vfeFrameId;
+	trace_msm_cam_vfe_out(msg.frameCounter, msgid);
+	msm_cam_latency_mark(MSM_CAM_LAT_VFE_OUT, msg.frameCounter);
 
     stream_condition = 1;
     wake_up_interruptible(&wait_q);
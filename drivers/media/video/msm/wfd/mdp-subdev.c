@@ -131,7 +131,7 @@ int mdp_dq_buffer(struct v4l2_subdev *sd, void *arg)
 {
 	int rc = 0;
 	struct mdp_buf_info *obuf = arg;
-	struct msmfb_data fbdata;
+	struct msmfb_writeback_frame frame;
 	struct mdp_instance *inst;
 	if (!arg) {
 		WFD_MSG_ERR("Invalid argument\n");
@@ -139,15 +139,16 @@ int mdp_dq_buffer(struct v4l2_subdev *sd, void *arg)
 	}
 
 	inst = obuf->inst;
-	fbdata.flags = MSMFB_WRITEBACK_DEQUEUE_BLOCKING;
-	rc = msm_fb_writeback_dequeue_buffer(inst->mdp, &fbdata);
+	frame.buf_info.flags = MSMFB_WRITEBACK_DEQUEUE_BLOCKING;
+	rc = msm_fb_writeback_dequeue_frame(inst->mdp, &frame);
 	if (rc) {
 		WFD_MSG_ERR("Failed to dequeue buffer\n");
 		return rc;
 	}
-	WFD_MSG_DBG("dequeue buf from mdp with priv = %u\n",
-			fbdata.priv);
-	obuf->cookie = (void *)fbdata.priv;
+	WFD_MSG_DBG("dequeue buf from mdp with priv = %u, seq = %u\n",
+			frame.buf_info.priv, frame.seq);
+	obuf->cookie = (void *)frame.buf_info.priv;
+	obuf->timestamp = frame.timestamp;
 	return rc;
 }
 int mdp_set_prop(struct v4l2_subdev *sd, void *arg)
@@ -26,6 +26,8 @@ struct mdp_buf_info {
 	u32 offset;
 	u32 kvaddr;
 	u32 paddr;
+	/* CLOCK_MONOTONIC time (ns) the frame was written, 0 if unknown */
+	u64 timestamp;
 };
 
 struct mdp_prop {
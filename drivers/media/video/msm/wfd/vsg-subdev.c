@@ -386,7 +386,12 @@ static long vsg_queue_buffer(struct v4l2_subdev *sd, void *arg)
 	*buf_info = *(struct vsg_buf_info *)arg;
 	INIT_LIST_HEAD(&buf_info->node);
 	buf_info->flags = 0;
-	ktime_get_ts(&buf_info->time);
+	/* Prefer the time MDP finished writing the frame, if known */
+	if (buf_info->mdp_buf_info.timestamp)
+		buf_info->time = ns_to_timespec(
+				buf_info->mdp_buf_info.timestamp);
+	else
+		ktime_get_ts(&buf_info->time);
 
 	WFD_MSG_DBG("Queue frame with paddr %p\n",
 			(void *)buf_info->mdp_buf_info.paddr);
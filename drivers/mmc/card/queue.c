@@ -162,6 +162,21 @@ static void mmc_queue_setup_discard(struct request_queue *q,
 		queue_flag_set_unlocked(QUEUE_FLAG_SECDISCARD, q);
 }
 
+/*
+ * Tell the filesystems (and mkfs) about the card's geometry: writes of
+ * whole super pages avoid a read-modify-write inside the card, and data
+ * kept within preferred erase units leaves less for its garbage
+ * collection to move.
+ */
+static void mmc_queue_setup_geometry(struct request_queue *q,
+				     struct mmc_card *card)
+{
+	if (mmc_card_mmc(card) && card->ext_csd.acc_size)
+		blk_queue_io_min(q, card->ext_csd.acc_size << 9);
+	if (card->pref_erase)
+		blk_queue_io_opt(q, card->pref_erase << 9);
+}
+
 static void mmc_queue_setup_sanitize(struct request_queue *q)
 {
 	queue_flag_set_unlocked(QUEUE_FLAG_SANITIZE, q);
@@ -206,6 +221,7 @@ int mmc_init_queue(struct mmc_queue *mq, struct mmc_card *card,
 	queue_flag_set_unlocked(QUEUE_FLAG_NONROT, mq->queue);
 	if (mmc_can_erase(card))
 		mmc_queue_setup_discard(mq->queue, card);
+	mmc_queue_setup_geometry(mq->queue, card);
 
 	if ((mmc_can_sanitize(card) && (host->caps2 & MMC_CAP2_SANITIZE)))
 		mmc_queue_setup_sanitize(mq->queue);
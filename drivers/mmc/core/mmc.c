@@ -326,6 +326,8 @@ static int mmc_read_ext_csd(struct mmc_card *card, u8 *ext_csd)
 		ext_csd[EXT_CSD_HC_ERASE_GRP_SIZE];
 	if (card->ext_csd.rev >= 3) {
 		u8 sa_shift = ext_csd[EXT_CSD_S_A_TIMEOUT];
+		u8 acc_size;
+
 		card->ext_csd.part_config = ext_csd[EXT_CSD_PART_CONFIG];
 
 		/* EXT_CSD value is in units of 10ms, but we store in ms */
@@ -349,6 +351,11 @@ static int mmc_read_ext_csd(struct mmc_card *card, u8 *ext_csd)
 		 * multiples of 128K.
 		 */
 		card->ext_csd.boot_size = ext_csd[EXT_CSD_BOOT_MULT] << 17;
+
+		/* Super page size, the unit the card programs its flash in */
+		acc_size = ext_csd[EXT_CSD_ACC_SIZE] & 0xf;
+		if (acc_size > 0 && acc_size <= 8)
+			card->ext_csd.acc_size = 1 << (acc_size - 1);
 	}
 
 	card->ext_csd.raw_hc_erase_gap_size =
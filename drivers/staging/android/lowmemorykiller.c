@@ -212,7 +212,12 @@ static int lowmem_shrink(struct shrinker *s, struct shrink_control *sc)
 			task_unlock(p);
 			continue;
 		}
-		tasksize = get_mm_rss(mm);
+		/*
+		 * Count driver-owned buffers (GPU, ION) charged to the
+		 * process as well, since they are released when it dies.
+		 */
+		tasksize = get_mm_rss(mm) +
+			get_mm_counter(mm, MM_UNRECLAIMABLE);
 		task_unlock(p);
 		if (tasksize <= 0)
 			continue;
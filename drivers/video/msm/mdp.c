@@ -2430,6 +2430,7 @@ static int mdp_probe(struct platform_device *pdev)
 		pdata->off = mdp4_dsi_video_off;
 		mfd->hw_refresh = TRUE;
 		mfd->dma_fnc = mdp4_dsi_video_overlay;
+		mfd->vsync_ctrl = mdp4_dsi_video_vsync_ctrl;
 		mfd->lut_update = mdp_lut_update_lcdc;
 		mfd->do_histogram = mdp_do_histogram;
 		mfd->start_histogram = mdp_histogram_start;
@@ -2468,6 +2469,7 @@ static int mdp_probe(struct platform_device *pdev)
 	case MIPI_CMD_PANEL:
 #ifndef CONFIG_FB_MSM_MDP303
 		mfd->dma_fnc = mdp4_dsi_cmd_overlay;
+		mfd->vsync_ctrl = mdp4_dsi_cmd_vsync_ctrl;
 		mipi = &mfd->panel_info.mipi;
 		configure_mdp_core_clk_table((mipi->dsi_pclk_rate) * 3 / 2);
 		if (mfd->panel_info.pdest == DISPLAY_1) {
@@ -2515,6 +2517,7 @@ static int mdp_probe(struct platform_device *pdev)
 		mfd->hw_refresh = TRUE;
 		mfd->cursor_update = mdp_hw_cursor_update;
 		mfd->dma_fnc = mdp4_dtv_overlay;
+		mfd->vsync_ctrl = mdp4_dtv_vsync_ctrl;
 		mfd->dma = &dma_e_data;
 		mdp4_display_intf_sel(EXTERNAL_INTF_SEL, DTV_INTF);
 		break;
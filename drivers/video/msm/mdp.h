@@ -282,6 +282,8 @@ extern struct mdp_hist_mgmt *mdp_hist_mgmt_array[];
 #define MDP_HISTOGRAM_TERM_DMA_S 0x200
 #define MDP_HISTOGRAM_TERM_VG_1 0x400
 #define MDP_HISTOGRAM_TERM_VG_2 0x800
+#define MDP_VSYNC_TERM_PRIMARY 0x1000
+#define MDP_VSYNC_TERM_EXTERNAL 0x2000
 
 #define ACTIVE_START_X_EN BIT(31)
 #define ACTIVE_START_Y_EN BIT(31)
@@ -550,6 +550,11 @@ void mdp4_overlay1_done_dtv(void);
 void mdp4_overlay1_done_atv(void);
 void mdp4_primary_vsync_lcdc(void);
 void mdp4_external_vsync_dtv(void);
+void mdp4_primary_rdptr(void);
+void mdp4_vsync_event_ctrl(uint32 intr, uint32 term, int enable);
+void mdp4_dsi_video_vsync_ctrl(struct msm_fb_data_type *mfd, int enable);
+void mdp4_dsi_cmd_vsync_ctrl(struct msm_fb_data_type *mfd, int enable);
+void mdp4_dtv_vsync_ctrl(struct msm_fb_data_type *mfd, int enable);
 void mdp4_overlay_lcdc_wait4vsync(struct msm_fb_data_type *mfd);
 void mdp4_overlay_lcdc_start(void);
 void mdp4_overlay_lcdc_vsync_push(struct msm_fb_data_type *mfd,
@@ -770,6 +775,8 @@ int mdp4_writeback_start(struct fb_info *info);
 int mdp4_writeback_stop(struct fb_info *info);
 int mdp4_writeback_dequeue_buffer(struct fb_info *info,
 		struct msmfb_data *data);
+int mdp4_writeback_dequeue_frame(struct fb_info *info,
+		struct msmfb_writeback_frame *frame);
 int mdp4_writeback_queue_buffer(struct fb_info *info,
 		struct msmfb_data *data);
 void mdp4_writeback_dma_stop(struct msm_fb_data_type *mfd);
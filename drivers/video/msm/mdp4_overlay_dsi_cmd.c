@@ -48,6 +48,12 @@ static unsigned long  tout_expired;
 
 static int vsync_start_y_adjust = 0;
 
+/* fb receiving TE events, protected by mdp_spin_lock */
+static struct msm_fb_data_type *vsync_event_mfd;
+
+/* line of the frame at which the read pointer interrupt fires */
+#define RDPTR_INTR_LINE	10
+
 struct timer_list dsi_clock_timer;
 
 void mdp4_overlay_dsi_state_set(int state)
@@ -410,6 +416,35 @@ void mdp4_blt_xy_update(struct mdp4_overlay_pipe *pipe)
 }
 
 
+/*
+ * mdp4_primary_rdptr: called from isr
+ * The read pointer is synchronized to the panel TE signal, so it is the
+ * closest thing to a vsync a command mode panel has.
+ */
+void mdp4_primary_rdptr(void)
+{
+	if (vsync_event_mfd)
+		msm_fb_vsync_event(vsync_event_mfd, ktime_get());
+}
+
+void mdp4_dsi_cmd_vsync_ctrl(struct msm_fb_data_type *mfd, int enable)
+{
+	unsigned long flag;
+
+	if (enable) {
+		mdp_pipe_ctrl(MDP_CMD_BLOCK, MDP_BLOCK_POWER_ON, FALSE);
+		MDP_OUTP(MDP_BASE + 0x021c, RDPTR_INTR_LINE);
+		mdp_pipe_ctrl(MDP_CMD_BLOCK, MDP_BLOCK_POWER_OFF, FALSE);
+	}
+
+	spin_lock_irqsave(&mdp_spin_lock, flag);
+	vsync_event_mfd = enable ? mfd : NULL;
+	spin_unlock_irqrestore(&mdp_spin_lock, flag);
+
+	mdp4_vsync_event_ctrl(INTR_PRIMARY_READ_PTR, MDP_VSYNC_TERM_PRIMARY,
+				enable);
+}
+
 /*
  * mdp4_dmap_done_dsi: called from isr
  * DAM_P_DONE only used when blt enabled
@@ -464,6 +464,8 @@ static void mdp4_dsi_video_blt_dmap_update(struct mdp4_overlay_pipe *pipe)
 /* Move the globals into context data structure for 3.4 upgrade */
 static int first_time = 1;
 static ktime_t last_vsync_time_ns;
+/* fb receiving vsync events, protected by mdp_spin_lock */
+static struct msm_fb_data_type *vsync_event_mfd;
 struct hrtimer hr_mdp_timer_pc;
 
 static unsigned long compute_vsync_interval(void)
@@ -650,11 +652,25 @@ void mdp4_primary_vsync_dsi_video(void)
 {
 	complete_all(&dsi_video_comp);
 	last_vsync_time_ns = ktime_get();
+	if (vsync_event_mfd)
+		msm_fb_vsync_event(vsync_event_mfd, last_vsync_time_ns);
 	/* Release Wakelock */
 	if (wake_lock_active(&mdp_idle_wakelock))
 		wake_unlock(&mdp_idle_wakelock);
 }
 
+void mdp4_dsi_video_vsync_ctrl(struct msm_fb_data_type *mfd, int enable)
+{
+	unsigned long flag;
+
+	spin_lock_irqsave(&mdp_spin_lock, flag);
+	vsync_event_mfd = enable ? mfd : NULL;
+	spin_unlock_irqrestore(&mdp_spin_lock, flag);
+
+	mdp4_vsync_event_ctrl(INTR_PRIMARY_VSYNC, MDP_VSYNC_TERM_PRIMARY,
+				enable);
+}
+
  /*
  * mdp4_dma_p_done_dsi_video: called from isr
  */
@@ -55,6 +55,8 @@ static int dtv_enabled;
 
 static struct mdp4_overlay_pipe *dtv_pipe;
 static DECLARE_COMPLETION(dtv_comp);
+/* fb receiving vsync events, protected by mdp_spin_lock */
+static struct msm_fb_data_type *vsync_event_mfd;
 
 static int mdp4_dtv_start(struct msm_fb_data_type *mfd)
 {
@@ -565,6 +567,20 @@ void mdp4_external_vsync_dtv()
 {
 
 	complete_all(&dtv_comp);
+	if (vsync_event_mfd)
+		msm_fb_vsync_event(vsync_event_mfd, ktime_get());
+}
+
+void mdp4_dtv_vsync_ctrl(struct msm_fb_data_type *mfd, int enable)
+{
+	unsigned long flag;
+
+	spin_lock_irqsave(&mdp_spin_lock, flag);
+	vsync_event_mfd = enable ? mfd : NULL;
+	spin_unlock_irqrestore(&mdp_spin_lock, flag);
+
+	mdp4_vsync_event_ctrl(INTR_EXTERNAL_VSYNC, MDP_VSYNC_TERM_EXTERNAL,
+				enable);
 }
 
 /*
@@ -48,6 +48,7 @@ enum {
 static struct mdp4_overlay_pipe *writeback_pipe;
 static struct msm_fb_data_type *writeback_mfd;
 static int busy_wait_cnt;
+static ktime_t writeback_done_time;
 
 int mdp4_overlay_writeback_on(struct platform_device *pdev)
 {
@@ -214,6 +215,9 @@ void mdp4_writeback_dma_busy_wait(struct msm_fb_data_type *mfd)
 void mdp4_overlay1_done_writeback(struct mdp_dma_data *dma)
 {
 	spin_lock(&mdp_spin_lock);
+	/* only a kickoff we are waiting on produced a frame */
+	if (dma->busy)
+		writeback_done_time = ktime_get();
 	dma->busy = FALSE;
 	if (busy_wait_cnt)
 		busy_wait_cnt = 0;
@@ -230,6 +234,7 @@ void mdp4_writeback_overlay_kickoff(struct msm_fb_data_type *mfd,
 	spin_lock_irqsave(&mdp_spin_lock, flag);
 	mdp_enable_irq(MDP_OVERLAY2_TERM);
 
+	writeback_done_time = ktime_set(0, 0);
 	mfd->dma->busy = TRUE;
 	outp32(MDP_INTR_CLEAR, INTR_OVERLAY2_DONE);
 	mdp_intr_mask |= INTR_OVERLAY2_DONE;
@@ -253,6 +258,27 @@ void mdp4_writeback_dma_stop(struct msm_fb_data_type *mfd)
 	}
 }
 
+/*
+ * Hand a written buffer to the busy queue.  The caller must have waited
+ * for the overlay to complete so the consumer never sees a partial frame.
+ * If nothing was written into it (panel off) its timestamp is zero.
+ */
+static void mdp4_writeback_buffer_done(struct msm_fb_data_type *mfd,
+		struct msmfb_writeback_data_list *node)
+{
+	unsigned long flag;
+
+	mutex_lock(&mfd->writeback_mutex);
+	spin_lock_irqsave(&mdp_spin_lock, flag);
+	node->timestamp = writeback_done_time;
+	spin_unlock_irqrestore(&mdp_spin_lock, flag);
+	node->seq = mfd->writeback_seq++;
+	list_add_tail(&node->active_entry, &mfd->writeback_busy_queue);
+	mfd->writeback_active_cnt--;
+	mutex_unlock(&mfd->writeback_mutex);
+	wake_up(&mfd->wait_q);
+}
+
 void mdp4_writeback_kickoff_video(struct msm_fb_data_type *mfd,
 		struct mdp4_overlay_pipe *pipe)
 {
@@ -287,13 +313,10 @@ void mdp4_writeback_kickoff_video(struct msm_fb_data_type *mfd,
 	pr_debug("%s: pid=%d\n", __func__, current->pid);
 
 	mdp4_writeback_overlay_kickoff(mfd, pipe);
+	mdp4_writeback_dma_busy_wait(mfd);
 
-	mutex_lock(&mfd->writeback_mutex);
-	list_add_tail(&node->active_entry, &mfd->writeback_busy_queue);
-	mutex_unlock(&mfd->writeback_mutex);
-	mfd->writeback_active_cnt--;
+	mdp4_writeback_buffer_done(mfd, node);
 	mutex_unlock(&mfd->unregister_mutex);
-	wake_up(&mfd->wait_q);
 }
 
 void mdp4_writeback_kickoff_ui(struct msm_fb_data_type *mfd,
@@ -308,6 +331,7 @@ void mdp4_writeback_overlay(struct msm_fb_data_type *mfd)
 {
 	int ret = 0;
 	struct msmfb_writeback_data_list *node = NULL;
+	unsigned long flag;
 
 	mutex_lock(&mfd->unregister_mutex);
 	mutex_lock(&mfd->writeback_mutex);
@@ -353,6 +377,7 @@ void mdp4_writeback_overlay(struct msm_fb_data_type *mfd)
 		pr_debug("%s: in writeback pan display 0x%x\n", __func__,
 				(unsigned int)writeback_pipe->ov_blt_addr);
 		mdp4_writeback_kickoff_ui(mfd, writeback_pipe);
+		mdp4_writeback_dma_busy_wait(mfd);
 		mdp4_iommu_unmap(writeback_pipe);
 
 		/* signal if pan function is waiting for the
@@ -361,13 +386,13 @@ void mdp4_writeback_overlay(struct msm_fb_data_type *mfd)
 			mfd->pan_waiting = FALSE;
 			complete(&mfd->pan_comp);
 		}
+	} else {
+		spin_lock_irqsave(&mdp_spin_lock, flag);
+		writeback_done_time = ktime_set(0, 0);
+		spin_unlock_irqrestore(&mdp_spin_lock, flag);
 	}
 
-	mutex_lock(&mfd->writeback_mutex);
-	list_add_tail(&node->active_entry, &mfd->writeback_busy_queue);
-	mfd->writeback_active_cnt--;
-	mutex_unlock(&mfd->writeback_mutex);
-	wake_up(&mfd->wait_q);
+	mdp4_writeback_buffer_done(mfd, node);
 fail_no_blt_addr:
 	/*NOTE: This api was removed
 	  mdp4_overlay_resource_release();*/
@@ -385,81 +410,112 @@ static int mdp4_overlay_writeback_register_buffer(
 	list_add_tail(&node->registered_entry, &mfd->writeback_register_queue);
 	return 0;
 }
+
+static int mdp4_writeback_domain(void)
+{
+	if (mdp_iommu_split_domain)
+		return DISPLAY_WRITE_DOMAIN;
+	else
+		return DISPLAY_READ_DOMAIN;
+}
+
+/*
+ * Registered buffers keep their ION handle and IOMMU mapping until the
+ * session is terminated, so a buffer cycling through queue/dequeue is
+ * only mapped once.  ION buffers are matched by handle (importing the
+ * same buffer again returns the client's existing handle), buffers
+ * passed by address are matched by iova.
+ */
+static struct msmfb_writeback_data_list *find_registered(
+			struct msm_fb_data_type *mfd, struct msmfb_data *data,
+			struct ion_handle *ihdl)
+{
+	struct msmfb_writeback_data_list *temp;
+
+	list_for_each_entry(temp, &mfd->writeback_register_queue,
+			registered_entry) {
+		if (data->iova) {
+			if (temp->buf_info.iova == data->iova)
+				return temp;
+		} else if (ihdl && temp->ihdl == ihdl &&
+			   temp->buf_info.offset == data->offset) {
+			return temp;
+		}
+	}
+	return NULL;
+}
+
 static struct msmfb_writeback_data_list *get_if_registered(
 			struct msm_fb_data_type *mfd, struct msmfb_data *data)
 {
 	struct msmfb_writeback_data_list *temp;
-	bool found = false;
-	int domain;
+	struct ion_handle *srcp_ihdl = NULL;
 
-	if (!list_empty(&mfd->writeback_register_queue)) {
-		list_for_each_entry(temp,
-				&mfd->writeback_register_queue,
-				registered_entry) {
-			if (temp && temp->buf_info.iova == data->iova) {
-				found = true;
-				break;
-			}
+	if (!data->iova && mfd->iclient) {
+		srcp_ihdl = ion_import_fd(mfd->iclient, data->memory_id);
+		if (IS_ERR_OR_NULL(srcp_ihdl)) {
+			pr_err("%s: ion import fd failed\n", __func__);
+			return NULL;
 		}
 	}
-	if (!found) {
-		temp = kzalloc(sizeof(struct msmfb_writeback_data_list),
-				GFP_KERNEL);
-		if (temp == NULL) {
-			pr_err("%s: out of memory\n", __func__);
-			goto register_alloc_fail;
-		}
-		temp->ihdl = NULL;
-		if (data->iova)
-			temp->addr = (void *)(data->iova + data->offset);
-		else if (mfd->iclient) {
-			struct ion_handle *srcp_ihdl;
-			ulong len;
-			srcp_ihdl = ion_import_fd(mfd->iclient,
-						  data->memory_id);
-			if (IS_ERR_OR_NULL(srcp_ihdl)) {
-				pr_err("%s: ion import fd failed\n", __func__);
-				goto register_ion_fail;
-			}
 
-			if (mdp_iommu_split_domain)
-				domain = DISPLAY_WRITE_DOMAIN;
-			else
-				domain = DISPLAY_READ_DOMAIN;
-
-			if (ion_map_iommu(mfd->iclient,
-					  srcp_ihdl,
-					  domain,
-					  GEN_POOL,
-					  SZ_4K,
-					  0,
-					  (ulong *)&temp->addr,
-					  (ulong *)&len,
-					  0,
-					  ION_IOMMU_UNMAP_DELAYED)) {
-				ion_free(mfd->iclient, srcp_ihdl);
-				pr_err("%s: unable to get ion mapping addr\n",
-				       __func__);
-				goto register_ion_fail;
-			}
-			temp->addr += data->offset;
-			temp->ihdl = srcp_ihdl;
-		}
-		else {
-			pr_err("%s: only support ion memory\n", __func__);
-			goto register_ion_fail;
-		}
+	temp = find_registered(mfd, data, srcp_ihdl);
+	if (temp) {
+		/* drop the reference taken by the import above */
+		if (srcp_ihdl)
+			ion_free(mfd->iclient, srcp_ihdl);
+		return temp;
+	}
 
-		memcpy(&temp->buf_info, data, sizeof(struct msmfb_data));
-		if (mdp4_overlay_writeback_register_buffer(mfd, temp)) {
-			pr_err("%s: error registering node\n", __func__);
+	temp = kzalloc(sizeof(struct msmfb_writeback_data_list),
+			GFP_KERNEL);
+	if (temp == NULL) {
+		pr_err("%s: out of memory\n", __func__);
+		goto register_alloc_fail;
+	}
+	temp->ihdl = NULL;
+	if (data->iova)
+		temp->addr = (void *)(data->iova + data->offset);
+	else if (srcp_ihdl) {
+		ulong len;
+
+		if (ion_map_iommu(mfd->iclient,
+				  srcp_ihdl,
+				  mdp4_writeback_domain(),
+				  GEN_POOL,
+				  SZ_4K,
+				  0,
+				  (ulong *)&temp->addr,
+				  (ulong *)&len,
+				  0,
+				  ION_IOMMU_UNMAP_DELAYED)) {
+			pr_err("%s: unable to get ion mapping addr\n",
+			       __func__);
 			goto register_ion_fail;
 		}
+		temp->addr += data->offset;
+		temp->ihdl = srcp_ihdl;
+	} else {
+		pr_err("%s: only support ion memory\n", __func__);
+		goto register_ion_fail;
+	}
+
+	memcpy(&temp->buf_info, data, sizeof(struct msmfb_data));
+	if (mdp4_overlay_writeback_register_buffer(mfd, temp)) {
+		pr_err("%s: error registering node\n", __func__);
+		goto register_map_fail;
 	}
 	return temp;
+
+ register_map_fail:
+	if (temp->ihdl)
+		ion_unmap_iommu(mfd->iclient, temp->ihdl,
+				mdp4_writeback_domain(), GEN_POOL);
  register_ion_fail:
 	kfree(temp);
  register_alloc_fail:
+	if (srcp_ihdl)
+		ion_free(mfd->iclient, srcp_ihdl);
 	return NULL;
 }
 int mdp4_writeback_start(
@@ -488,6 +544,8 @@ int mdp4_writeback_queue_buffer(struct fb_info *info, struct msmfb_data *data)
 		goto exit;
 	}
 
+	/* the cookie in priv may differ between queues of the same buffer */
+	memcpy(&node->buf_info, data, sizeof(struct msmfb_data));
 	list_add_tail(&node->active_entry, &mfd->writeback_free_queue);
 	node->state = IN_FREE_QUEUE;
 
@@ -504,16 +562,22 @@ static int is_buffer_ready(struct msm_fb_data_type *mfd)
 	mutex_unlock(&mfd->writeback_mutex);
 	return rc;
 }
-int mdp4_writeback_dequeue_buffer(struct fb_info *info, struct msmfb_data *data)
+int mdp4_writeback_dequeue_frame(struct fb_info *info,
+		struct msmfb_writeback_frame *frame)
 {
 	struct msm_fb_data_type *mfd = (struct msm_fb_data_type *)info->par;
 	struct msmfb_writeback_data_list *node = NULL;
-	int rc = 0, domain;
+	int rc = 0;
 
-	rc = wait_event_interruptible(mfd->wait_q, is_buffer_ready(mfd));
-	if (rc) {
-		pr_err("failed to get dequeued buffer\n");
-		return -ENOBUFS;
+	if (frame->buf_info.flags & MSMFB_WRITEBACK_DEQUEUE_BLOCKING) {
+		rc = wait_event_interruptible(mfd->wait_q,
+				is_buffer_ready(mfd));
+		if (rc) {
+			pr_err("failed to get dequeued buffer\n");
+			return -ENOBUFS;
+		}
+	} else if (!is_buffer_ready(mfd)) {
+		return -EAGAIN;
 	}
 	mutex_lock(&mfd->writeback_mutex);
 	if (mfd->writeback_state == WB_STOPING) {
@@ -527,21 +591,10 @@ int mdp4_writeback_dequeue_buffer(struct fb_info *info, struct msmfb_data *data)
 	if (node) {
 		list_del(&node->active_entry);
 		node->state = WITH_CLIENT;
-		memcpy(data, &node->buf_info, sizeof(struct msmfb_data));
-		if (!data->iova)
-			if (mfd->iclient && node->ihdl) {
-				if (mdp_iommu_split_domain)
-					domain = DISPLAY_WRITE_DOMAIN;
-				else
-					domain = DISPLAY_READ_DOMAIN;
-
-				ion_unmap_iommu(mfd->iclient,
-						node->ihdl,
-						domain,
-						GEN_POOL);
-				ion_free(mfd->iclient,
-					 node->ihdl);
-			}
+		memcpy(&frame->buf_info, &node->buf_info,
+				sizeof(struct msmfb_data));
+		frame->seq = node->seq;
+		frame->timestamp = ktime_to_ns(node->timestamp);
 	} else {
 		pr_err("node is NULL. Somebody else dequeued?\n");
 		rc = -ENOBUFS;
@@ -550,6 +603,20 @@ int mdp4_writeback_dequeue_buffer(struct fb_info *info, struct msmfb_data *data)
 	return rc;
 }
 
+int mdp4_writeback_dequeue_buffer(struct fb_info *info, struct msmfb_data *data)
+{
+	struct msmfb_writeback_frame frame;
+	int rc;
+
+	memcpy(&frame.buf_info, data, sizeof(struct msmfb_data));
+	/* the legacy ioctl always blocked, whatever the flags say */
+	frame.buf_info.flags |= MSMFB_WRITEBACK_DEQUEUE_BLOCKING;
+	rc = mdp4_writeback_dequeue_frame(info, &frame);
+	if (!rc)
+		memcpy(data, &frame.buf_info, sizeof(struct msmfb_data));
+	return rc;
+}
+
 static bool is_writeback_inactive(struct msm_fb_data_type *mfd)
 {
 	bool active;
@@ -581,6 +648,7 @@ int mdp4_writeback_init(struct fb_info *info)
 	INIT_LIST_HEAD(&mfd->writeback_busy_queue);
 	INIT_LIST_HEAD(&mfd->writeback_register_queue);
 	mfd->writeback_state = WB_OPEN;
+	mfd->writeback_seq = 0;
 	init_waitqueue_head(&mfd->wait_q);
 	return 0;
 }
@@ -609,6 +677,12 @@ int mdp4_writeback_terminate(struct fb_info *info)
 					struct msmfb_writeback_data_list,
 					registered_entry);
 			list_del(&temp->registered_entry);
+			if (mfd->iclient && temp->ihdl) {
+				ion_unmap_iommu(mfd->iclient, temp->ihdl,
+						mdp4_writeback_domain(),
+						GEN_POOL);
+				ion_free(mfd->iclient, temp->ihdl);
+			}
 			kfree(temp);
 		}
 	}
@@ -354,6 +354,38 @@ void mdp4_clear_lcdc(void)
 	mdp_pipe_ctrl(MDP_CMD_BLOCK, MDP_BLOCK_POWER_OFF, FALSE);
 }
 
+/* vsync type interrupts kept enabled by mdp4_isr for vsync event listeners */
+static uint32 mdp4_vsync_event_intr;
+
+/*
+ * mdp4_vsync_event_ctrl: keep a vsync type interrupt enabled across isr
+ * invocations so that every vsync can be reported to userspace.  On
+ * disable the interrupt goes back to one shot use and is dropped by the
+ * isr after it fires next, so pending vsync waiters are not affected.
+ */
+void mdp4_vsync_event_ctrl(uint32 intr, uint32 term, int enable)
+{
+	unsigned long flag;
+
+	mdp_pipe_ctrl(MDP_CMD_BLOCK, MDP_BLOCK_POWER_ON, FALSE);
+	spin_lock_irqsave(&mdp_spin_lock, flag);
+	if (enable) {
+		mdp4_vsync_event_intr |= intr;
+		outp32(MDP_INTR_CLEAR, intr);
+		mdp_intr_mask |= intr;
+		outp32(MDP_INTR_ENABLE, mdp_intr_mask);
+	} else {
+		mdp4_vsync_event_intr &= ~intr;
+	}
+	spin_unlock_irqrestore(&mdp_spin_lock, flag);
+	mdp_pipe_ctrl(MDP_CMD_BLOCK, MDP_BLOCK_POWER_OFF, FALSE);
+
+	if (enable)
+		mdp_enable_irq(term);
+	else
+		mdp_disable_irq(term);
+}
+
 irqreturn_t mdp4_isr(int irq, void *ptr)
 {
 	uint32 isr, mask, panel;
@@ -408,8 +440,10 @@ irqreturn_t mdp4_isr(int irq, void *ptr)
 		mdp4_stat.intr_vsync_p++;
 		dma = &dma2_data;
 		spin_lock(&mdp_spin_lock);
-		mdp_intr_mask &= ~INTR_PRIMARY_VSYNC;
-		outp32(MDP_INTR_ENABLE, mdp_intr_mask);
+		if (!(mdp4_vsync_event_intr & INTR_PRIMARY_VSYNC)) {
+			mdp_intr_mask &= ~INTR_PRIMARY_VSYNC;
+			outp32(MDP_INTR_ENABLE, mdp_intr_mask);
+		}
 		dma->waiting = FALSE;
 		if (panel & MDP4_PANEL_LCDC)
 			mdp4_primary_vsync_lcdc();
@@ -424,14 +458,29 @@ irqreturn_t mdp4_isr(int irq, void *ptr)
 		mdp4_stat.intr_vsync_e++;
 		dma = &dma_e_data;
 		spin_lock(&mdp_spin_lock);
-		mdp_intr_mask &= ~INTR_EXTERNAL_VSYNC;
-		outp32(MDP_INTR_ENABLE, mdp_intr_mask);
+		if (!(mdp4_vsync_event_intr & INTR_EXTERNAL_VSYNC)) {
+			mdp_intr_mask &= ~INTR_EXTERNAL_VSYNC;
+			outp32(MDP_INTR_ENABLE, mdp_intr_mask);
+		}
 		dma->waiting = FALSE;
 		if (panel & MDP4_PANEL_DTV)
 			mdp4_external_vsync_dtv();
 		spin_unlock(&mdp_spin_lock);
 	}
 #endif
+#ifdef CONFIG_FB_MSM_MIPI_DSI
+	if (isr & INTR_PRIMARY_READ_PTR) {
+		mdp4_stat.intr_rd_ptr++;
+		spin_lock(&mdp_spin_lock);
+		if (!(mdp4_vsync_event_intr & INTR_PRIMARY_READ_PTR)) {
+			mdp_intr_mask &= ~INTR_PRIMARY_READ_PTR;
+			outp32(MDP_INTR_ENABLE, mdp_intr_mask);
+		}
+		if (panel & MDP4_PANEL_DSI_CMD)
+			mdp4_primary_rdptr();
+		spin_unlock(&mdp_spin_lock);
+	}
+#endif
 
 #ifdef CONFIG_FB_MSM_OVERLAY
 	if (isr & INTR_OVERLAY0_DONE) {
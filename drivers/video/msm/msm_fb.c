@@ -459,6 +459,145 @@ static int msm_fb_probe(struct platform_device *pdev)
 	return 0;
 }
 
+/*
+ * msm_fb_vsync_event: called from isr with the time of a hardware vsync
+ * (video mode), TE read pointer (command mode) or DTV vsync.  Pollers of
+ * the vsync_event sysfs node are woken up.
+ */
+void msm_fb_vsync_event(struct msm_fb_data_type *mfd, ktime_t vsync_time)
+{
+	unsigned long flag;
+
+	spin_lock_irqsave(&mfd->vsync_time_lock, flag);
+	mfd->vsync_time = vsync_time;
+	spin_unlock_irqrestore(&mfd->vsync_time_lock, flag);
+
+	if (mfd->vsync_event_sd)
+		sysfs_notify_dirent(mfd->vsync_event_sd);
+}
+
+static ssize_t msm_fb_vsync_show_event(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct fb_info *fbi = dev_get_drvdata(dev);
+	struct msm_fb_data_type *mfd = (struct msm_fb_data_type *)fbi->par;
+	unsigned long flag;
+	ktime_t vsync_time;
+
+	spin_lock_irqsave(&mfd->vsync_time_lock, flag);
+	vsync_time = mfd->vsync_time;
+	spin_unlock_irqrestore(&mfd->vsync_time_lock, flag);
+
+	return scnprintf(buf, PAGE_SIZE, "VSYNC=%llu\n",
+			ktime_to_ns(vsync_time));
+}
+
+static DEVICE_ATTR(vsync_event, S_IRUGO, msm_fb_vsync_show_event, NULL);
+
+/*
+ * Vsync event enables are also counted per process, so that they are
+ * dropped with the process that made them even when it dies without
+ * disabling them. The fb ops are not told which file is opened or
+ * released, hence the process rather than the file.
+ */
+static struct msm_fb_proc_info *msm_fb_find_proc(
+		struct msm_fb_data_type *mfd, pid_t pid)
+{
+	struct msm_fb_proc_info *pinfo;
+
+	list_for_each_entry(pinfo, &mfd->proc_list, list)
+		if (pinfo->pid == pid)
+			return pinfo;
+	return NULL;
+}
+
+static void msm_fb_proc_open(struct msm_fb_data_type *mfd)
+{
+	struct msm_fb_proc_info *pinfo;
+
+	mutex_lock(&mfd->vsync_mutex);
+	pinfo = msm_fb_find_proc(mfd, current->tgid);
+	if (!pinfo) {
+		pinfo = kzalloc(sizeof(*pinfo), GFP_KERNEL);
+		if (!pinfo) {
+			/* its vsync enables only go with the last close */
+			mutex_unlock(&mfd->vsync_mutex);
+			return;
+		}
+		pinfo->pid = current->tgid;
+		list_add(&pinfo->list, &mfd->proc_list);
+	}
+	pinfo->ref_cnt++;
+	mutex_unlock(&mfd->vsync_mutex);
+}
+
+static void msm_fb_proc_release(struct msm_fb_data_type *mfd)
+{
+	struct msm_fb_proc_info *pinfo;
+
+	mutex_lock(&mfd->vsync_mutex);
+	pinfo = msm_fb_find_proc(mfd, current->tgid);
+	if (pinfo && --pinfo->ref_cnt == 0) {
+		if (pinfo->vsync_cnt && mfd->vsync_ctrl_cnt > 0) {
+			mfd->vsync_ctrl_cnt -= pinfo->vsync_cnt;
+			if (mfd->vsync_ctrl_cnt <= 0) {
+				mfd->vsync_ctrl_cnt = 0;
+				mfd->vsync_ctrl(mfd, 0);
+			}
+		}
+		list_del(&pinfo->list);
+		kfree(pinfo);
+	}
+	mutex_unlock(&mfd->vsync_mutex);
+}
+
+/*
+ * msm_fb_vsync_ctrl: reference counted enable of vsync events, the
+ * interrupt is only left on while somebody listens.
+ */
+static int msm_fb_vsync_ctrl(struct msm_fb_data_type *mfd, int enable)
+{
+	struct msm_fb_proc_info *pinfo;
+
+	if (!mfd->vsync_ctrl)
+		return -ENODEV;
+
+	mutex_lock(&mfd->vsync_mutex);
+	pinfo = msm_fb_find_proc(mfd, current->tgid);
+	if (enable) {
+		if (pinfo)
+			pinfo->vsync_cnt++;
+		if (mfd->vsync_ctrl_cnt++ == 0)
+			mfd->vsync_ctrl(mfd, 1);
+	} else if (pinfo ? pinfo->vsync_cnt > 0 : mfd->vsync_ctrl_cnt > 0) {
+		/* a process can only drop the enables it made */
+		if (pinfo)
+			pinfo->vsync_cnt--;
+		if (--mfd->vsync_ctrl_cnt == 0)
+			mfd->vsync_ctrl(mfd, 0);
+	}
+	mutex_unlock(&mfd->vsync_mutex);
+
+	return 0;
+}
+
+/* Drop all vsync enables, when the fb is closed for the last time */
+static void msm_fb_vsync_ctrl_reset(struct msm_fb_data_type *mfd)
+{
+	struct msm_fb_proc_info *pinfo, *tmp;
+
+	mutex_lock(&mfd->vsync_mutex);
+	if (mfd->vsync_ctrl_cnt > 0) {
+		mfd->vsync_ctrl_cnt = 0;
+		mfd->vsync_ctrl(mfd, 0);
+	}
+	list_for_each_entry_safe(pinfo, tmp, &mfd->proc_list, list) {
+		list_del(&pinfo->list);
+		kfree(pinfo);
+	}
+	mutex_unlock(&mfd->vsync_mutex);
+}
+
 static int msm_fb_remove(struct platform_device *pdev)
 {
 	struct msm_fb_data_type *mfd;
@@ -504,6 +643,13 @@ static int msm_fb_remove(struct platform_device *pdev)
 	if (mfd->fbi->node == 0)
 		wake_lock_destroy(&mdp_idle_wakelock);
 
+	if (mfd->vsync_event_sd) {
+		msm_fb_vsync_ctrl_reset(mfd);
+		sysfs_put(mfd->vsync_event_sd);
+		mfd->vsync_event_sd = NULL;
+		device_remove_file(mfd->fbi->dev, &dev_attr_vsync_event);
+	}
+
 	/* remove /dev/fb* */
 	unregister_framebuffer(mfd->fbi);
 
@@ -1439,6 +1585,10 @@ static int msm_fb_register(struct msm_fb_data_type *mfd)
 	init_completion(&mfd->msmfb_update_notify);
 	init_completion(&mfd->msmfb_no_update_notify);
 
+	mutex_init(&mfd->vsync_mutex);
+	INIT_LIST_HEAD(&mfd->proc_list);
+	spin_lock_init(&mfd->vsync_time_lock);
+
 	fbram_offset = PAGE_ALIGN((int)fbram)-(int)fbram;
 	fbram += fbram_offset;
 	fbram_phys += fbram_offset;
@@ -1517,6 +1667,15 @@ static int msm_fb_register(struct msm_fb_data_type *mfd)
 	if (fbi->node == 0)
 		wake_lock_init(&mdp_idle_wakelock, WAKE_LOCK_IDLE, "mdp");
 
+	if (mfd->vsync_ctrl) {
+		if (device_create_file(fbi->dev, &dev_attr_vsync_event))
+			pr_err("%s: vsync_event sysfs creation failed\n",
+				__func__);
+		else
+			mfd->vsync_event_sd = sysfs_get_dirent(
+				fbi->dev->kobj.sd, NULL, "vsync_event");
+	}
+
 	fbram += fix->smem_len;
 	fbram_phys += fix->smem_len;
 	fbram_size -= fix->smem_len;
@@ -1684,6 +1843,7 @@ static int msm_fb_open(struct fb_info *info, int user)
 	}
 
 	if (info->node == 0 && !(mfd->cont_splash_done)) {	/* primary */
+			msm_fb_proc_open(mfd);
 			mfd->ref_cnt++;
 			return 0;
 	}
@@ -1718,6 +1878,7 @@ static int msm_fb_open(struct fb_info *info, int user)
 #endif /* CONFIG_DISP_EXT_BLC */
 	}
 
+	msm_fb_proc_open(mfd);
 	mfd->ref_cnt++;
     MSM_FB_DEBUG("msm_fb_open():end mfd->ref_cnt = %d-----\n",mfd->ref_cnt);
 	return 0;
@@ -1735,8 +1896,12 @@ static int msm_fb_release(struct fb_info *info, int user)
 	}
 
 	mfd->ref_cnt--;
+	msm_fb_proc_release(mfd);
 
 	if (!mfd->ref_cnt) {
+		/* nobody is left to listen for vsync events */
+		msm_fb_vsync_ctrl_reset(mfd);
+
 		if ((ret =
 		     msm_fb_blank_sub(FB_BLANK_POWERDOWN, info,
 				      mfd->op_enable)) != 0) {
@@ -3084,6 +3249,21 @@ static int msmfb_overlay_play_enable(struct fb_info *info, unsigned long *argp)
 	return 0;
 }
 
+static int msmfb_overlay_vsync_ctrl(struct fb_info *info, void __user *argp)
+{
+	int ret;
+	unsigned int enable;
+	struct msm_fb_data_type *mfd = (struct msm_fb_data_type *)info->par;
+
+	ret = copy_from_user(&enable, argp, sizeof(enable));
+	if (ret) {
+		pr_err("%s: ioctl failed\n", __func__);
+		return -EFAULT;
+	}
+
+	return msm_fb_vsync_ctrl(mfd, enable);
+}
+
 static int msmfb_overlay_blt(struct fb_info *info, unsigned long *argp)
 {
 	int     ret;
@@ -3195,11 +3375,37 @@ static int msmfb_overlay_ioctl_writeback_dequeue_buffer(
 		goto error;
 
 error:
-	if (ret)
+	if (ret && ret != -EAGAIN)
 		pr_err("%s:msmfb_writeback_dequeue_buffer ioctl failed\n",
 				__func__);
 	return ret;
 }
+
+static int msmfb_overlay_ioctl_writeback_dequeue_frame(
+		struct fb_info *info, unsigned long *argp)
+{
+	int ret = 0;
+	struct msmfb_writeback_frame frame;
+
+	if (copy_from_user(&frame, argp, sizeof(frame))) {
+		ret = -EFAULT;
+		goto error;
+	}
+
+	ret = mdp4_writeback_dequeue_frame(info, &frame);
+	if (ret)
+		goto error;
+
+	if (copy_to_user(argp, &frame, sizeof(frame)))
+		ret = -EFAULT;
+
+error:
+	if (ret && ret != -EAGAIN)
+		pr_err("%s:msmfb_writeback_dequeue_frame ioctl failed\n",
+				__func__);
+	return ret;
+}
+
 static int msmfb_overlay_ioctl_writeback_terminate(struct fb_info *info)
 {
 	return mdp4_writeback_terminate(info);
@@ -3233,6 +3439,12 @@ static int msmfb_overlay_ioctl_writeback_dequeue_buffer(
 {
 	return -ENOTSUPP;
 }
+
+static int msmfb_overlay_ioctl_writeback_dequeue_frame(
+		struct fb_info *info, unsigned long *argp)
+{
+	return -ENOTSUPP;
+}
 static int msmfb_overlay_ioctl_writeback_terminate(struct fb_info *info)
 {
 	return -ENOTSUPP;
@@ -3490,6 +3702,9 @@ static int msm_fb_ioctl(struct fb_info *info, unsigned int cmd,
 		ret = msmfb_overlay_play_enable(info, argp);
 		up(&msm_fb_ioctl_ppp_sem);
 		break;
+	case MSMFB_OVERLAY_VSYNC_CTRL:
+		ret = msmfb_overlay_vsync_ctrl(info, argp);
+		break;
 	case MSMFB_OVERLAY_PLAY_WAIT:
 		down(&msm_fb_ioctl_ppp_sem);
 		ret = msmfb_overlay_play_wait(info, argp);
@@ -3534,6 +3749,10 @@ static int msm_fb_ioctl(struct fb_info *info, unsigned int cmd,
 		ret = msmfb_overlay_ioctl_writeback_dequeue_buffer(
 				info, argp);
 		break;
+	case MSMFB_WRITEBACK_DEQUEUE_FRAME:
+		ret = msmfb_overlay_ioctl_writeback_dequeue_frame(
+				info, argp);
+		break;
 	case MSMFB_WRITEBACK_TERMINATE:
 		ret = msmfb_overlay_ioctl_writeback_terminate(info);
 		break;
@@ -3982,6 +4201,13 @@ int msm_fb_writeback_dequeue_buffer(struct fb_info *info,
 }
 EXPORT_SYMBOL(msm_fb_writeback_dequeue_buffer);
 
+int msm_fb_writeback_dequeue_frame(struct fb_info *info,
+		struct msmfb_writeback_frame *frame)
+{
+	return mdp4_writeback_dequeue_frame(info, frame);
+}
+EXPORT_SYMBOL(msm_fb_writeback_dequeue_frame);
+
 int msm_fb_writeback_stop(struct fb_info *info)
 {
 	return mdp4_writeback_stop(info);
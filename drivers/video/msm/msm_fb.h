@@ -73,9 +73,19 @@ struct msmfb_writeback_data_list {
 	struct msmfb_data buf_info;
 	struct msmfb_img img;
 	int state;
+	u32 seq;
+	ktime_t timestamp;
 };
 
 
+/* What one process holds on an fb */
+struct msm_fb_proc_info {
+	pid_t pid;
+	int ref_cnt;		/* opens */
+	int vsync_cnt;		/* vsync event enables */
+	struct list_head list;
+};
+
 struct msm_fb_data_type {
 	__u32 key;
 	__u32 index;
@@ -125,6 +135,15 @@ struct msm_fb_data_type {
 
 	ktime_t last_vsync_timetick;
 
+	/* hardware vsync events published through sysfs vsync_event */
+	void (*vsync_ctrl) (struct msm_fb_data_type *mfd, int enable);
+	struct mutex vsync_mutex;
+	int vsync_ctrl_cnt;
+	struct list_head proc_list;	/* struct msm_fb_proc_info */
+	spinlock_t vsync_time_lock;
+	ktime_t vsync_time;
+	struct sysfs_dirent *vsync_event_sd;
+
 	__u32 *vsync_width_boundary;
 
 	unsigned int pmem_id;
@@ -194,6 +213,7 @@ struct msm_fb_data_type {
 	u32 use_ov1_blt, ov1_blt_state;
 	u32 writeback_state;
 	bool writeback_active_cnt;
+	u32 writeback_seq;
 	int cont_splash_done;
 };
 
@@ -210,9 +230,12 @@ int msm_fb_writeback_queue_buffer(struct fb_info *info,
 		struct msmfb_data *data);
 int msm_fb_writeback_dequeue_buffer(struct fb_info *info,
 		struct msmfb_data *data);
+int msm_fb_writeback_dequeue_frame(struct fb_info *info,
+		struct msmfb_writeback_frame *frame);
 int msm_fb_writeback_stop(struct fb_info *info);
 int msm_fb_writeback_terminate(struct fb_info *info);
 int msm_fb_detect_client(const char *name);
+void msm_fb_vsync_event(struct msm_fb_data_type *mfd, ktime_t vsync_time);
 int calc_fb_offset(struct msm_fb_data_type *mfd, struct fb_info *fbi, int bpp);
 
 #ifdef CONFIG_FB_BACKLIGHT
@@ -81,7 +81,8 @@ struct vcd_buffer_entry {
 	u32 allocated;
 	u32 in_use;
 	struct vcd_frame_data frame;
-
+	u64 sched_ts;
+	u64 sched_deadline;
 };
 
 struct vcd_buffer_pool {
@@ -167,13 +168,23 @@ struct vcd_clnt_status {
 	u32 mask;
 };
 
+struct vcd_sched_stats {
+	u32 frames;
+	u32 misses;
+	u32 max_depth;
+	u32 max_latency;
+	u64 total_latency;
+};
+
 struct vcd_sched_clnt_ctx {
 	struct list_head list;
 	u32 clnt_active;
 	void *clnt_data;
 	u32 tkns;
-	u32 round_perfrm;
-	u32 rounds;
+	u32 frm_period;
+	u64 last_deadline;
+	u32 depth;
+	struct vcd_sched_stats stats;
 	struct list_head ip_frm_list;
 };
 
@@ -11,19 +11,92 @@
  *
  */
 
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/ktime.h>
 #include <media/msm/vidc_type.h>
+#include <media/msm/vidc_init.h>
 #include "vcd.h"
 
-#define NORMALIZATION_FACTOR 3600
-#define ADJUST_CLIENT_ROUNDS(client, round_adjustment) \
-do {\
-	if ((client)->rounds < round_adjustment) {\
-		(client)->rounds = 0;\
-		VCD_MSG_HIGH("%s(): WARNING: Scheduler list unsorted",\
-			__func__);\
-	} else\
-		(client)->rounds -= round_adjustment;\
-} while (0)
+/*
+ * Frames are run earliest deadline first. Each input frame gets its
+ * deadline when it is queued: one frame period after the later of its
+ * arrival and the deadline of the frame queued before it. A session that
+ * keeps up therefore has a deadline one period out, while a backlogged
+ * session has its frames spread a period apart and cannot crowd out a
+ * real-time session running at its configured rate.
+ */
+static u64 vcd_sched_now(void)
+{
+	return ktime_to_us(ktime_get());
+}
+
+static u32 vcd_sched_frm_period(struct vcd_clnt_ctxt *cctxt)
+{
+	if (!cctxt->frm_rate.fps_numerator)
+		return USEC_PER_SEC / VCD_DEC_INITIAL_FRAME_RATE;
+	return (u32) div_u64((u64) USEC_PER_SEC *
+		cctxt->frm_rate.fps_denominator,
+		cctxt->frm_rate.fps_numerator);
+}
+
+#ifdef VIDC_ENABLE_DBGFS
+static struct dentry *vcd_sched_debugfs;
+
+static int vcd_sched_stats_show(struct seq_file *s, void *unused)
+{
+	struct vcd_drv_ctxt *drv_ctxt = vcd_get_drv_context();
+	struct vcd_clnt_ctxt *cctxt;
+	struct vcd_sched_clnt_ctx *sched_cctxt;
+	struct vcd_sched_stats *stats;
+
+	seq_printf(s, "%-10s %-3s %-4s %8s %6s %8s %8s %8s %6s %6s\n",
+		"session", "dir", "live", "period", "queued", "frames",
+		"misses", "avg_lat", "max_lat", "max_q");
+	mutex_lock(&drv_ctxt->dev_mutex);
+	for (cctxt = drv_ctxt->dev_ctxt.cctxt_list_head; cctxt;
+		cctxt = cctxt->next) {
+		sched_cctxt = cctxt->sched_clnt_hdl;
+		if (!sched_cctxt)
+			continue;
+		stats = &sched_cctxt->stats;
+		seq_printf(s, "%p %-3s %-4u %8u %6u %8u %8u %8llu %6u %6u\n",
+			cctxt, cctxt->decoding ? "dec" : "enc", cctxt->live,
+			sched_cctxt->frm_period, sched_cctxt->depth,
+			stats->frames, stats->misses,
+			stats->frames ? div_u64(stats->total_latency,
+				stats->frames) : 0,
+			stats->max_latency, stats->max_depth);
+	}
+	mutex_unlock(&drv_ctxt->dev_mutex);
+	return 0;
+}
+
+static int vcd_sched_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, vcd_sched_stats_show, inode->i_private);
+}
+
+static const struct file_operations vcd_sched_stats_fops = {
+	.open = vcd_sched_stats_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+static void vcd_sched_debugfs_init(void)
+{
+	struct dentry *root;
+	if (vcd_sched_debugfs)
+		return;
+	root = vidc_get_debugfs_root();
+	if (root)
+		vcd_sched_debugfs = debugfs_create_file("vcd_sched_stats",
+			S_IRUGO, root, NULL, &vcd_sched_stats_fops);
+}
+#else
+static inline void vcd_sched_debugfs_init(void) {}
+#endif
 
 u32 vcd_sched_create(struct list_head *sched_list)
 {
@@ -31,8 +104,10 @@ u32 vcd_sched_create(struct list_head *sched_list)
 	if (!sched_list) {
 		VCD_MSG_ERROR("%s(): Invalid parameter", __func__);
 		rc = VCD_ERR_ILLEGAL_PARM;
-	} else
+	} else {
 		INIT_LIST_HEAD(sched_list);
+		vcd_sched_debugfs_init();
+	}
 	return rc;
 }
 
@@ -50,17 +125,6 @@ void vcd_sched_destroy(struct list_head *sched_clnt_list)
 void insert_client_in_list(struct list_head *sched_clnt_list,
 	struct vcd_sched_clnt_ctx *sched_new_clnt, bool tail)
 {
-	struct vcd_sched_clnt_ctx *sched_clnt;
-	if (!list_empty(sched_clnt_list)) {
-		if (tail)
-			sched_clnt = list_entry(sched_clnt_list->prev,
-				struct vcd_sched_clnt_ctx, list);
-		else
-			sched_clnt = list_first_entry(sched_clnt_list,
-				struct vcd_sched_clnt_ctx, list);
-		sched_new_clnt->rounds = sched_clnt->rounds;
-	} else
-		sched_new_clnt->rounds = 0;
 	if (tail)
 		list_add_tail(&sched_new_clnt->list, sched_clnt_list);
 	else
@@ -111,9 +175,7 @@ u32 vcd_sched_add_client(struct vcd_clnt_ctxt *cctxt)
 			memset(sched_cctxt, 0,
 				sizeof(struct vcd_sched_clnt_ctx));
 			sched_cctxt->tkns = 0;
-			sched_cctxt->round_perfrm = NORMALIZATION_FACTOR *
-				cctxt->frm_rate.fps_denominator /
-				cctxt->frm_rate.fps_numerator;
+			sched_cctxt->frm_period = vcd_sched_frm_period(cctxt);
 			sched_cctxt->clnt_active = true;
 			sched_cctxt->clnt_data = cctxt;
 			INIT_LIST_HEAD(&sched_cctxt->ip_frm_list);
@@ -153,16 +215,9 @@ u32 vcd_sched_update_config(struct vcd_clnt_ctxt *cctxt)
 	if (!cctxt || !cctxt->sched_clnt_hdl) {
 		VCD_MSG_ERROR("%s(): Invalid parameter", __func__);
 		rc = VCD_ERR_ILLEGAL_PARM;
-	} else {
-		cctxt->sched_clnt_hdl->rounds /=
-			cctxt->sched_clnt_hdl->round_perfrm;
-		cctxt->sched_clnt_hdl->round_perfrm =
-			NORMALIZATION_FACTOR *
-			cctxt->frm_rate.fps_denominator /
-			cctxt->frm_rate.fps_numerator;
-		cctxt->sched_clnt_hdl->rounds *=
-			cctxt->sched_clnt_hdl->round_perfrm;
-	}
+	} else
+		cctxt->sched_clnt_hdl->frm_period =
+			vcd_sched_frm_period(cctxt);
 	return rc;
 }
 
@@ -171,14 +226,28 @@ u32 vcd_sched_queue_buffer(
 	struct vcd_buffer_entry *buffer, u32 tail)
 {
 	u32 rc = VCD_S_SUCCESS;
+	u64 now;
 	if (!sched_cctxt || !buffer) {
 		VCD_MSG_ERROR("%s(): Invalid parameter", __func__);
 		rc = VCD_ERR_ILLEGAL_PARM;
-	} else if (tail)
-		list_add_tail(&buffer->sched_list,
+	} else {
+		if (tail) {
+			now = vcd_sched_now();
+			buffer->sched_ts = now;
+			buffer->sched_deadline = max(now,
+				sched_cctxt->last_deadline) +
+				sched_cctxt->frm_period;
+			sched_cctxt->last_deadline = buffer->sched_deadline;
+			list_add_tail(&buffer->sched_list,
 				&sched_cctxt->ip_frm_list);
-	else
-		list_add(&buffer->sched_list, &sched_cctxt->ip_frm_list);
+		} else
+			/* requeued frames keep their original deadline */
+			list_add(&buffer->sched_list,
+				&sched_cctxt->ip_frm_list);
+		sched_cctxt->depth++;
+		if (sched_cctxt->depth > sched_cctxt->stats.max_depth)
+			sched_cctxt->stats.max_depth = sched_cctxt->depth;
+	}
 	return rc;
 }
 
@@ -198,6 +267,10 @@ u32 vcd_sched_dequeue_buffer(
 					struct vcd_buffer_entry,
 					sched_list);
 			list_del(&(*buffer)->sched_list);
+			if (sched_cctxt->depth)
+				sched_cctxt->depth--;
+			if (list_empty(&sched_cctxt->ip_frm_list))
+				sched_cctxt->last_deadline = 0;
 			rc = VCD_S_SUCCESS;
 		}
 	}
@@ -242,44 +315,62 @@ u32 vcd_sched_suspend_resume_clnt(
 	return rc;
 }
 
+static void vcd_sched_account(struct vcd_sched_clnt_ctx *sched_cctxt,
+	struct vcd_buffer_entry *buffer)
+{
+	struct vcd_sched_stats *stats = &sched_cctxt->stats;
+	u64 now = vcd_sched_now();
+	u32 latency = (u32) min_t(u64, now - buffer->sched_ts, UINT_MAX);
+
+	stats->frames++;
+	stats->total_latency += latency;
+	if (latency > stats->max_latency)
+		stats->max_latency = latency;
+	if (now > buffer->sched_deadline) {
+		stats->misses++;
+		VCD_MSG_MED("%s(): client %p missed deadline by %llu us",
+			__func__, sched_cctxt->clnt_data,
+			now - buffer->sched_deadline);
+	}
+}
+
 u32 vcd_sched_get_client_frame(struct list_head *sched_clnt_list,
 	struct vcd_clnt_ctxt **cctxt,
 	struct vcd_buffer_entry **buffer)
 {
-	u32 rc = VCD_ERR_QEMPTY, round_adjustment = 0;
-	struct vcd_sched_clnt_ctx *sched_clnt, *clnt_nxt;
+	u32 rc = VCD_ERR_QEMPTY;
+	struct vcd_sched_clnt_ctx *sched_clnt, *best = NULL;
+	struct vcd_clnt_ctxt *clnt, *best_clnt = NULL;
+	struct vcd_buffer_entry *head;
+	u64 best_deadline = 0;
 	if (!sched_clnt_list || !cctxt || !buffer) {
 		VCD_MSG_ERROR("%s(): Invalid parameter", __func__);
 		rc = VCD_ERR_ILLEGAL_PARM;
 	} else if (!list_empty(sched_clnt_list)) {
 		*cctxt = NULL;
 		*buffer = NULL;
-		list_for_each_entry_safe(sched_clnt,
-			clnt_nxt, sched_clnt_list, list) {
-			if (&sched_clnt->list == sched_clnt_list->next)
-				round_adjustment = sched_clnt->rounds;
-			if (*cctxt) {
-				if ((*cctxt)->sched_clnt_hdl->rounds >=
-					sched_clnt->rounds)
-					list_move(&(*cctxt)->sched_clnt_hdl\
-						->list, &sched_clnt->list);
-				ADJUST_CLIENT_ROUNDS(sched_clnt,
-					round_adjustment);
-			} else if (sched_clnt->tkns &&
-				!list_empty(&sched_clnt->ip_frm_list)) {
-				*cctxt = sched_clnt->clnt_data;
-				sched_clnt->rounds += sched_clnt->round_perfrm;
-			} else
-				ADJUST_CLIENT_ROUNDS(sched_clnt,
-						round_adjustment);
+		list_for_each_entry(sched_clnt, sched_clnt_list, list) {
+			if (!sched_clnt->tkns ||
+				list_empty(&sched_clnt->ip_frm_list))
+				continue;
+			head = list_first_entry(&sched_clnt->ip_frm_list,
+				struct vcd_buffer_entry, sched_list);
+			clnt = sched_clnt->clnt_data;
+			/* on a tie, live sessions go first */
+			if (!best || head->sched_deadline < best_deadline ||
+				(head->sched_deadline == best_deadline &&
+				clnt->live && !best_clnt->live)) {
+				best = sched_clnt;
+				best_clnt = clnt;
+				best_deadline = head->sched_deadline;
+			}
 		}
-		if (*cctxt) {
-			rc = vcd_sched_dequeue_buffer(
-				(*cctxt)->sched_clnt_hdl, buffer);
+		if (best) {
+			rc = vcd_sched_dequeue_buffer(best, buffer);
 			if (rc == VCD_S_SUCCESS) {
-				(*cctxt)->sched_clnt_hdl->tkns--;
-				ADJUST_CLIENT_ROUNDS((*cctxt)->\
-					sched_clnt_hdl, round_adjustment);
+				*cctxt = best_clnt;
+				best->tkns--;
+				vcd_sched_account(best, *buffer);
 			}
 		}
 	}
@@ -211,12 +211,21 @@ int ext4_sync_file(struct file *file, int datasync)
 		goto out;
 	}
 
+	/*
+	 * With fsync_data_only, fsync of a regular file only waits for what
+	 * fdatasync would: overwriting already allocated blocks (the common
+	 * case for SQLite journals and databases) then needs no commit at
+	 * all, just the cache flush below. Timestamps and other changes that
+	 * are not needed to read the data back go out with the next commit.
+	 */
+	if (test_opt2(inode->i_sb, FSYNC_DATA_ONLY) && S_ISREG(inode->i_mode))
+		datasync = 1;
+
 	commit_tid = datasync ? ei->i_datasync_tid : ei->i_sync_tid;
 	if (journal->j_flags & JBD2_BARRIER &&
 	    !jbd2_trans_will_send_data_barrier(journal, commit_tid))
 		needs_barrier = true;
-	jbd2_log_start_commit(journal, commit_tid);
-	ret = jbd2_log_wait_commit(journal, commit_tid);
+	ret = jbd2_complete_transaction(journal, commit_tid);
 	if (needs_barrier)
 		blkdev_issue_flush(inode->i_sb->s_bdev, GFP_KERNEL, NULL);
  out:
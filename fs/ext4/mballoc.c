@@ -131,7 +131,9 @@
  * /sys/fs/ext4/<partition/mb_group_prealloc. The value is represented in
  * terms of number of blocks. If we have mounted the file system with -O
  * stripe=<value> option the group prealloc request is normalized to the
- * stripe value (sbi->s_stripe)
+ * stripe value (sbi->s_stripe). Without a stripe from the mount options or
+ * the superblock, the optimal I/O size of the device is used, which for
+ * eMMC is its preferred erase size.
  *
  * The regular allocator(using the buddy cache) supports few tunables.
  *
@@ -2472,6 +2474,14 @@ int ext4_mb_init(struct super_block *sb, int needs_recovery)
 	sbi->s_mb_stream_request = MB_DEFAULT_STREAM_THRESHOLD;
 	sbi->s_mb_order2_reqs = MB_DEFAULT_ORDER2_REQS;
 	sbi->s_mb_group_prealloc = MB_DEFAULT_GROUP_PREALLOC;
+	/*
+	 * Keep the locality group preallocations a whole number of stripes,
+	 * so that small files packed into them don't straddle stripes (or
+	 * erase units, when the stripe comes from the device).
+	 */
+	if (sbi->s_stripe > 1)
+		sbi->s_mb_group_prealloc = roundup(sbi->s_mb_group_prealloc,
+						   sbi->s_stripe);
 
 	sbi->s_locality_groups = alloc_percpu(struct ext4_locality_group);
 	if (sbi->s_locality_groups == NULL) {
@@ -2831,7 +2841,8 @@ out_err:
 /*
  * here we normalize request for locality group
  * Group request are normalized to s_strip size if we set the same via mount
- * option. If not we set it to s_mb_group_prealloc which can be configured via
+ * option, the superblock or the device's optimal I/O size. If not we set it
+ * to s_mb_group_prealloc which can be configured via
  * /sys/fs/ext4/<partition>/mb_group_prealloc
  *
  * XXX: should we try to preallocate more than the group has now?
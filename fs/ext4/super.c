@@ -1126,6 +1126,9 @@ static int ext4_show_options(struct seq_file *seq, struct vfsmount *vfs)
 	if (test_opt(sb, DIOREAD_NOLOCK))
 		seq_puts(seq, ",dioread_nolock");
 
+	if (test_opt2(sb, FSYNC_DATA_ONLY))
+		seq_puts(seq, ",fsync_data_only");
+
 	if (test_opt(sb, BLOCK_VALIDITY) &&
 	    !(def_mount_opts & EXT4_DEFM_BLOCK_VALIDITY))
 		seq_puts(seq, ",block_validity");
@@ -1310,6 +1313,7 @@ enum {
 	Opt_inode_readahead_blks, Opt_journal_ioprio,
 	Opt_dioread_nolock, Opt_dioread_lock,
 	Opt_discard, Opt_nodiscard, Opt_init_itable, Opt_noinit_itable,
+	Opt_fsync_data_only, Opt_nofsync_data_only,
 };
 
 static const match_table_t tokens = {
@@ -1385,6 +1389,8 @@ static const match_table_t tokens = {
 	{Opt_init_itable, "init_itable=%u"},
 	{Opt_init_itable, "init_itable"},
 	{Opt_noinit_itable, "noinit_itable"},
+	{Opt_fsync_data_only, "fsync_data_only"},
+	{Opt_nofsync_data_only, "nofsync_data_only"},
 	{Opt_err, NULL},
 };
 
@@ -1855,6 +1861,12 @@ set_qf_format:
 		case Opt_nodiscard:
 			clear_opt(sb, DISCARD);
 			break;
+		case Opt_fsync_data_only:
+			set_opt2(sb, FSYNC_DATA_ONLY);
+			break;
+		case Opt_nofsync_data_only:
+			clear_opt2(sb, FSYNC_DATA_ONLY);
+			break;
 		case Opt_dioread_nolock:
 			set_opt(sb, DIOREAD_NOLOCK);
 			break;
@@ -2382,33 +2394,60 @@ static ext4_fsblk_t descriptor_loc(struct super_block *sb,
 	return (has_super + ext4_group_first_block_no(sb, bg));
 }
 
+/*
+ * Optimal I/O size of the device in blocks, e.g. the preferred erase size
+ * of an eMMC. Only used if the partition starts on a multiple of it, as
+ * the allocator aligns to block numbers.
+ */
+static unsigned long ext4_get_device_stripe(struct super_block *sb)
+{
+	struct block_device *bdev = sb->s_bdev;
+	unsigned int io_opt = bdev_io_opt(bdev);
+	sector_t start = get_start_sect(bdev);
+
+	if (!io_opt || io_opt % sb->s_blocksize)
+		return 0;
+
+	if (sector_div(start, io_opt >> 9))
+		return 0;
+
+	return io_opt >> sb->s_blocksize_bits;
+}
+
 /**
  * ext4_get_stripe_size: Get the stripe size.
- * @sbi: In memory super block info
+ * @sb: super block
  *
  * If we have specified it via mount option, then
  * use the mount option value. If the value specified at mount time is
  * greater than the blocks per group use the super block value.
- * If the super block value is greater than blocks per group return 0.
+ * If the super block has no usable value either, fall back to the
+ * optimal I/O size the device reports.
  * Allocator needs it be less than blocks per group.
  *
  */
-static unsigned long ext4_get_stripe_size(struct ext4_sb_info *sbi)
+static unsigned long ext4_get_stripe_size(struct super_block *sb)
 {
+	struct ext4_sb_info *sbi = EXT4_SB(sb);
 	unsigned long stride = le16_to_cpu(sbi->s_es->s_raid_stride);
 	unsigned long stripe_width =
 			le32_to_cpu(sbi->s_es->s_raid_stripe_width);
+	unsigned long ret;
 
 	if (sbi->s_stripe && sbi->s_stripe <= sbi->s_blocks_per_group)
-		return sbi->s_stripe;
-
-	if (stripe_width <= sbi->s_blocks_per_group)
-		return stripe_width;
+		ret = sbi->s_stripe;
+	else if (stripe_width && stripe_width <= sbi->s_blocks_per_group)
+		ret = stripe_width;
+	else if (stride && stride <= sbi->s_blocks_per_group)
+		ret = stride;
+	else
+		ret = ext4_get_device_stripe(sb);
 
-	if (stride <= sbi->s_blocks_per_group)
-		return stride;
+	/* A one block stripe is no alignment at all */
+	if (ret <= 1 || ret > sbi->s_blocks_per_group)
+		ret = 0;
 
-	return 0;
+	return ret;
 }
 
 /* sysfs supprt */
@@ -3485,7 +3524,7 @@ static int ext4_fill_super(struct super_block *sb, void *data, int silent)
 		goto failed_mount3;
 	}
 
-	sbi->s_stripe = ext4_get_stripe_size(sbi);
+	sbi->s_stripe = ext4_get_stripe_size(sb);
 	sbi->s_max_writeback_mb_bump = 128;
 
 	/*
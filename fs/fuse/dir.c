@@ -1325,7 +1325,7 @@ static int fuse_do_setattr(struct dentry *entry, struct iattr *attr,
 	struct fuse_setattr_in inarg;
 	struct fuse_attr_out outarg;
 	bool is_truncate = false;
-	loff_t oldsize;
+	loff_t oldsize, newsize;
 	int err;
 
 	if (!fuse_allow_task(fc, current))
@@ -1397,7 +1397,12 @@ static int fuse_do_setattr(struct dentry *entry, struct iattr *attr,
 	fuse_change_attributes_common(inode, &outarg.attr,
 				      attr_timeout(&outarg));
 	oldsize = inode->i_size;
-	i_size_write(inode, outarg.attr.size);
+	newsize = oldsize;
+	/* Unless truncating, keep the size of pending cached writes */
+	if (is_truncate || !fc->writeback_cache || !S_ISREG(inode->i_mode)) {
+		newsize = outarg.attr.size;
+		i_size_write(inode, newsize);
+	}
 
 	if (is_truncate) {
 		/* NOTE: this may release/reacquire fc->lock */
@@ -1409,8 +1414,8 @@ static int fuse_do_setattr(struct dentry *entry, struct iattr *attr,
 	 * Only call invalidate_inode_pages2() after removing
 	 * FUSE_NOWRITE, otherwise fuse_launder_page() would deadlock.
 	 */
-	if (S_ISREG(inode->i_mode) && oldsize != outarg.attr.size) {
-		truncate_pagecache(inode, oldsize, outarg.attr.size);
+	if (S_ISREG(inode->i_mode) && oldsize != newsize) {
+		truncate_pagecache(inode, oldsize, newsize);
 		invalidate_inode_pages2(inode->i_mapping);
 	}
 
@@ -82,6 +82,7 @@ EXPORT_SYMBOL(jbd2_journal_errno);
 EXPORT_SYMBOL(jbd2_journal_ack_err);
 EXPORT_SYMBOL(jbd2_journal_clear_err);
 EXPORT_SYMBOL(jbd2_log_wait_commit);
+EXPORT_SYMBOL(jbd2_complete_transaction);
 EXPORT_SYMBOL(jbd2_log_start_commit);
 EXPORT_SYMBOL(jbd2_journal_start_commit);
 EXPORT_SYMBOL(jbd2_journal_force_commit_nested);
@@ -662,6 +663,32 @@ int jbd2_log_wait_commit(journal_t *journal, tid_t tid)
 	return err;
 }
 
+/*
+ * Make sure the given transaction is on disk, committing it if needed.
+ * fsync of a file whose last metadata change has already been committed
+ * needs no commit at all; how often that is the case shows up in the
+ * journal's info file.
+ */
+int jbd2_complete_transaction(journal_t *journal, tid_t tid)
+{
+	int committed;
+
+	read_lock(&journal->j_state_lock);
+	committed = tid_geq(journal->j_commit_sequence, tid);
+	read_unlock(&journal->j_state_lock);
+
+	spin_lock(&journal->j_history_lock);
+	if (committed)
+		journal->j_stats.ts_sync_nocommit++;
+	else
+		journal->j_stats.ts_sync_commit++;
+	spin_unlock(&journal->j_history_lock);
+
+	if (!committed)
+		jbd2_log_start_commit(journal, tid);
+	return jbd2_log_wait_commit(journal, tid);
+}
+
 /*
  * Log buffer allocation routines:
  */
@@ -770,6 +797,9 @@ static int jbd2_seq_info_show(struct seq_file *seq, void *v)
 	seq_printf(seq, "%lu transaction, each up to %u blocks\n",
 			s->stats->ts_tid,
 			s->journal->j_max_transaction_buffers);
+	seq_printf(seq, "%lu of %lu sync waits needed no commit\n",
+			s->stats->ts_sync_nocommit,
+			s->stats->ts_sync_nocommit + s->stats->ts_sync_commit);
 	if (s->stats->ts_tid == 0)
 		return 0;
 	seq_printf(seq, "average: \n  %ums waiting for transaction\n",
@@ -0,0 +1,99 @@
+/* Copyright (c) 2012, Code Aurora Forum. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#include <linux/fs.h>
+#include <linux/namei.h>
+#include <linux/mount.h>
+#include <linux/fs_stack.h>
+#include <linux/slab.h>
+
+#include "sdcardfs.h"
+
+struct kmem_cache *sdcardfs_dentry_cachep;
+
+int sdcardfs_new_dentry_private(struct dentry *dentry)
+{
+	struct sdcardfs_dentry_info *info;
+
+	info = kmem_cache_zalloc(sdcardfs_dentry_cachep, GFP_KERNEL);
+	if (!info)
+		return -ENOMEM;
+
+	dentry->d_fsdata = info;
+	return 0;
+}
+
+void sdcardfs_free_dentry_private(struct dentry *dentry)
+{
+	struct sdcardfs_dentry_info *info = SDCARDFS_D(dentry);
+
+	if (!info)
+		return;
+
+	path_put(&info->lower_path);
+	kmem_cache_free(sdcardfs_dentry_cachep, info);
+	dentry->d_fsdata = NULL;
+}
+
+/*
+ * The lower directory may change behind our back (e.g. from the media
+ * scanner working on /data/media directly), so check that the upper
+ * dentry still matches the lower one. The derived owner is refreshed
+ * here as well, which is what makes renames and package changes visible.
+ */
+static int sdcardfs_d_revalidate(struct dentry *dentry, struct nameidata *nd)
+{
+	struct dentry *lower_dentry;
+	struct dentry *parent;
+	struct inode *inode;
+	int valid = 1;
+
+	if (nd && nd->flags & LOOKUP_RCU)
+		return -ECHILD;
+
+	lower_dentry = sdcardfs_lower_dentry(dentry);
+	if (d_unhashed(lower_dentry))
+		return 0;
+
+	if (lower_dentry->d_op && lower_dentry->d_op->d_revalidate) {
+		valid = lower_dentry->d_op->d_revalidate(lower_dentry, NULL);
+		if (valid <= 0)
+			return valid;
+	}
+
+	inode = dentry->d_inode;
+	if (!inode)
+		return !lower_dentry->d_inode;
+	if (sdcardfs_lower_inode(inode) != lower_dentry->d_inode)
+		return 0;
+
+	parent = dget_parent(dentry);
+	if (parent != dentry) {
+		sdcardfs_derive_perm(parent->d_inode, inode,
+				     dentry->d_name.name);
+		sdcardfs_update_attr(inode);
+	}
+	dput(parent);
+
+	return valid;
+}
+
+static void sdcardfs_d_release(struct dentry *dentry)
+{
+	sdcardfs_free_dentry_private(dentry);
+}
+
+const struct dentry_operations sdcardfs_dops = {
+	.d_revalidate	= sdcardfs_d_revalidate,
+	.d_release	= sdcardfs_d_release,
+};
@@ -0,0 +1,111 @@
+/* Copyright (c) 2012, Code Aurora Forum. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+/*
+ * Owner and mode of the nodes shown through sdcardfs.
+ *
+ * Nothing on the lower filesystem is trusted: every node is shown as owned
+ * by the mount's uid/gid, with the mode reduced to what the lower owner
+ * bits allow, the same way the userspace sdcard daemon presents it. With
+ * "derive" the directories under Android/data and Android/obb are owned
+ * by the app whose package name they carry and hidden from others.
+ */
+
+#include <linux/fs.h>
+#include <linux/fs_stack.h>
+#include <linux/string.h>
+
+#include "sdcardfs.h"
+
+void sdcardfs_init_root_perm(struct inode *inode)
+{
+	struct sdcardfs_sb_info *sbi = SDCARDFS_SB(inode->i_sb);
+	struct sdcardfs_inode_info *info = SDCARDFS_I(inode);
+
+	info->perm = PERM_ROOT;
+	info->d_uid = sbi->options.fs_uid;
+	info->app_private = false;
+}
+
+/* Called on every lookup, so that renames and package changes show up */
+void sdcardfs_derive_perm(struct inode *parent, struct inode *inode,
+			  const char *name)
+{
+	struct sdcardfs_sb_info *sbi = SDCARDFS_SB(inode->i_sb);
+	struct sdcardfs_inode_info *pinfo = SDCARDFS_I(parent);
+	struct sdcardfs_inode_info *info = SDCARDFS_I(inode);
+	uid_t appid;
+
+	info->perm = PERM_INHERIT;
+	info->d_uid = pinfo->d_uid;
+	info->app_private = pinfo->app_private;
+
+	if (!sbi->options.derive)
+		return;
+
+	switch (pinfo->perm) {
+	case PERM_INHERIT:
+	case PERM_ANDROID_PACKAGE:
+		break;
+	case PERM_ROOT:
+		/* The sdcard is case insensitive for the daemon too */
+		if (!strcasecmp(name, "Android"))
+			info->perm = PERM_ANDROID;
+		break;
+	case PERM_ANDROID:
+		if (!strcasecmp(name, "data"))
+			info->perm = PERM_ANDROID_DATA;
+		else if (!strcasecmp(name, "obb"))
+			info->perm = PERM_ANDROID_OBB;
+		break;
+	case PERM_ANDROID_DATA:
+	case PERM_ANDROID_OBB:
+		info->perm = PERM_ANDROID_PACKAGE;
+		info->app_private = true;
+		appid = sdcardfs_package_appid(name);
+		if (appid)
+			info->d_uid = appid;
+		break;
+	}
+}
+
+/*
+ * Refresh the attributes from the lower inode, with the derived owner and
+ * mode in place of the lower ones.
+ */
+void sdcardfs_update_attr(struct inode *inode)
+{
+	struct sdcardfs_sb_info *sbi = SDCARDFS_SB(inode->i_sb);
+	struct sdcardfs_inode_info *info = SDCARDFS_I(inode);
+	struct inode *lower_inode = info->lower_inode;
+	umode_t visible_mode = 0775 & ~sbi->options.mask;
+	umode_t owner_mode = lower_inode->i_mode & 0700;
+
+	if (info->app_private)
+		visible_mode &= ~0007;
+
+	inode->i_rdev = lower_inode->i_rdev;
+	inode->i_atime = lower_inode->i_atime;
+	inode->i_mtime = lower_inode->i_mtime;
+	inode->i_ctime = lower_inode->i_ctime;
+	inode->i_blkbits = lower_inode->i_blkbits;
+	inode->i_flags = lower_inode->i_flags;
+	inode->i_nlink = lower_inode->i_nlink;
+	fsstack_copy_inode_size(inode, lower_inode);
+
+	inode->i_uid = info->d_uid;
+	inode->i_gid = sbi->options.fs_gid;
+	inode->i_mode = (lower_inode->i_mode & S_IFMT) |
+		(visible_mode & (owner_mode | (owner_mode >> 3) |
+				 (owner_mode >> 6)));
+}
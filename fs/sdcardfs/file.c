@@ -0,0 +1,248 @@
+/* Copyright (c) 2012, Code Aurora Forum. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+/*
+ * Every open sdcardfs file has an open lower file, and all data goes
+ * straight to it: there is no page cache at this level. Reads, writes and
+ * splices are passed down as they are, and mappings are made of the
+ * lower file itself.
+ */
+
+#include <linux/fs.h>
+#include <linux/file.h>
+#include <linux/mm.h>
+#include <linux/mount.h>
+#include <linux/fs_stack.h>
+#include <linux/slab.h>
+#include <linux/compat.h>
+
+#include "sdcardfs.h"
+
+struct kmem_cache *sdcardfs_file_cachep;
+
+static ssize_t sdcardfs_read(struct file *file, char __user *buf,
+			     size_t count, loff_t *ppos)
+{
+	struct file *lower_file = sdcardfs_lower_file(file);
+	ssize_t err;
+
+	err = vfs_read(lower_file, buf, count, ppos);
+	if (err >= 0)
+		fsstack_copy_attr_atime(file->f_path.dentry->d_inode,
+					lower_file->f_path.dentry->d_inode);
+	return err;
+}
+
+static ssize_t sdcardfs_write(struct file *file, const char __user *buf,
+			      size_t count, loff_t *ppos)
+{
+	struct file *lower_file = sdcardfs_lower_file(file);
+	struct inode *inode = file->f_path.dentry->d_inode;
+	ssize_t err;
+
+	err = vfs_write(lower_file, buf, count, ppos);
+	if (err >= 0) {
+		fsstack_copy_inode_size(inode, sdcardfs_lower_inode(inode));
+		fsstack_copy_attr_times(inode, sdcardfs_lower_inode(inode));
+	}
+	return err;
+}
+
+static ssize_t sdcardfs_splice_read(struct file *file, loff_t *ppos,
+				    struct pipe_inode_info *pipe, size_t len,
+				    unsigned int flags)
+{
+	struct file *lower_file = sdcardfs_lower_file(file);
+
+	if (!lower_file->f_op || !lower_file->f_op->splice_read)
+		return -EINVAL;
+	return lower_file->f_op->splice_read(lower_file, ppos, pipe, len,
+					     flags);
+}
+
+static ssize_t sdcardfs_splice_write(struct pipe_inode_info *pipe,
+				     struct file *file, loff_t *ppos,
+				     size_t len, unsigned int flags)
+{
+	struct file *lower_file = sdcardfs_lower_file(file);
+	struct inode *inode = file->f_path.dentry->d_inode;
+	ssize_t err;
+
+	if (!lower_file->f_op || !lower_file->f_op->splice_write)
+		return -EINVAL;
+
+	err = lower_file->f_op->splice_write(pipe, lower_file, ppos, len,
+					     flags);
+	if (err >= 0) {
+		fsstack_copy_inode_size(inode, sdcardfs_lower_inode(inode));
+		fsstack_copy_attr_times(inode, sdcardfs_lower_inode(inode));
+	}
+	return err;
+}
+
+static loff_t sdcardfs_llseek(struct file *file, loff_t offset, int origin)
+{
+	struct file *lower_file = sdcardfs_lower_file(file);
+	loff_t err;
+
+	lower_file->f_pos = file->f_pos;
+	err = vfs_llseek(lower_file, offset, origin);
+	if (err >= 0)
+		file->f_pos = lower_file->f_pos;
+	return err;
+}
+
+static int sdcardfs_readdir(struct file *file, void *dirent, filldir_t filldir)
+{
+	struct file *lower_file = sdcardfs_lower_file(file);
+	struct inode *inode = file->f_path.dentry->d_inode;
+	const struct cred *saved_cred;
+	int err;
+
+	lower_file->f_pos = file->f_pos;
+	saved_cred = sdcardfs_override_creds(inode->i_sb);
+	err = vfs_readdir(lower_file, filldir, dirent);
+	revert_creds(saved_cred);
+	file->f_pos = lower_file->f_pos;
+
+	if (err >= 0)
+		fsstack_copy_attr_atime(inode, lower_file->f_path.dentry->d_inode);
+	return err;
+}
+
+/*
+ * Hand the mapping over to the lower file, so that faults are served
+ * from the lower page cache and there is only one copy of the data.
+ */
+static int sdcardfs_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct file *lower_file = sdcardfs_lower_file(file);
+	int err;
+
+	if (!lower_file->f_op || !lower_file->f_op->mmap)
+		return -ENODEV;
+
+	get_file(lower_file);
+	vma->vm_file = lower_file;
+	err = lower_file->f_op->mmap(lower_file, vma);
+	if (err) {
+		vma->vm_file = file;
+		fput(lower_file);
+		return err;
+	}
+
+	/* mmap_region() took this reference for the vma */
+	fput(file);
+	return 0;
+}
+
+static int sdcardfs_open(struct inode *inode, struct file *file)
+{
+	struct sdcardfs_file_info *info;
+	struct path lower_path;
+	struct file *lower_file;
+
+	info = kmem_cache_zalloc(sdcardfs_file_cachep, GFP_KERNEL);
+	if (!info)
+		return -ENOMEM;
+
+	/* Access was checked on the derived attributes by the VFS */
+	sdcardfs_get_lower_path(file->f_path.dentry, &lower_path);
+	lower_file = dentry_open(lower_path.dentry, lower_path.mnt,
+				 file->f_flags,
+				 SDCARDFS_SB(inode->i_sb)->lower_cred);
+	if (IS_ERR(lower_file)) {
+		kmem_cache_free(sdcardfs_file_cachep, info);
+		return PTR_ERR(lower_file);
+	}
+
+	info->lower_file = lower_file;
+	file->private_data = info;
+	sdcardfs_update_attr(inode);
+	return 0;
+}
+
+static int sdcardfs_flush(struct file *file, fl_owner_t id)
+{
+	struct file *lower_file = sdcardfs_lower_file(file);
+
+	if (lower_file->f_op && lower_file->f_op->flush)
+		return lower_file->f_op->flush(lower_file, id);
+	return 0;
+}
+
+static int sdcardfs_release(struct inode *inode, struct file *file)
+{
+	struct sdcardfs_file_info *info = file->private_data;
+
+	fput(info->lower_file);
+	kmem_cache_free(sdcardfs_file_cachep, info);
+	return 0;
+}
+
+static int sdcardfs_fsync(struct file *file, int datasync)
+{
+	return vfs_fsync(sdcardfs_lower_file(file), datasync);
+}
+
+static long sdcardfs_unlocked_ioctl(struct file *file, unsigned int cmd,
+				    unsigned long arg)
+{
+	struct file *lower_file = sdcardfs_lower_file(file);
+
+	if (lower_file->f_op && lower_file->f_op->unlocked_ioctl)
+		return lower_file->f_op->unlocked_ioctl(lower_file, cmd, arg);
+	return -ENOTTY;
+}
+
+#ifdef CONFIG_COMPAT
+static long sdcardfs_compat_ioctl(struct file *file, unsigned int cmd,
+				  unsigned long arg)
+{
+	struct file *lower_file = sdcardfs_lower_file(file);
+
+	if (lower_file->f_op && lower_file->f_op->compat_ioctl)
+		return lower_file->f_op->compat_ioctl(lower_file, cmd, arg);
+	return -ENOIOCTLCMD;
+}
+#endif
+
+const struct file_operations sdcardfs_main_fops = {
+	.llseek		= sdcardfs_llseek,
+	.read		= sdcardfs_read,
+	.write		= sdcardfs_write,
+	.unlocked_ioctl	= sdcardfs_unlocked_ioctl,
+#ifdef CONFIG_COMPAT
+	.compat_ioctl	= sdcardfs_compat_ioctl,
+#endif
+	.mmap		= sdcardfs_mmap,
+	.open		= sdcardfs_open,
+	.flush		= sdcardfs_flush,
+	.release	= sdcardfs_release,
+	.fsync		= sdcardfs_fsync,
+	.splice_read	= sdcardfs_splice_read,
+	.splice_write	= sdcardfs_splice_write,
+};
+
+const struct file_operations sdcardfs_dir_fops = {
+	.llseek		= sdcardfs_llseek,
+	.read		= generic_read_dir,
+	.readdir	= sdcardfs_readdir,
+	.unlocked_ioctl	= sdcardfs_unlocked_ioctl,
+#ifdef CONFIG_COMPAT
+	.compat_ioctl	= sdcardfs_compat_ioctl,
+#endif
+	.open		= sdcardfs_open,
+	.release	= sdcardfs_release,
+	.fsync		= sdcardfs_fsync,
+};
@@ -0,0 +1,401 @@
+/* Copyright (c) 2012, Code Aurora Forum. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#include <linux/fs.h>
+#include <linux/namei.h>
+#include <linux/mount.h>
+#include <linux/fs_stack.h>
+#include <linux/slab.h>
+
+#include "sdcardfs.h"
+
+static struct dentry *lock_parent(struct dentry *dentry)
+{
+	struct dentry *dir;
+
+	dir = dget_parent(dentry);
+	mutex_lock_nested(&dir->d_inode->i_mutex, I_MUTEX_PARENT);
+	return dir;
+}
+
+static void unlock_dir(struct dentry *dir)
+{
+	mutex_unlock(&dir->d_inode->i_mutex);
+	dput(dir);
+}
+
+static int sdcardfs_inode_test(struct inode *inode, void *lower_inode)
+{
+	return sdcardfs_lower_inode(inode) == lower_inode;
+}
+
+static int sdcardfs_inode_set(struct inode *inode, void *opaque)
+{
+	struct inode *lower_inode = opaque;
+
+	SDCARDFS_I(inode)->lower_inode = lower_inode;
+	inode->i_ino = lower_inode->i_ino;
+	inode->i_mode = lower_inode->i_mode;
+	inode->i_version++;
+	inode->i_mapping->backing_dev_info = inode->i_sb->s_bdi;
+
+	if (S_ISDIR(inode->i_mode)) {
+		inode->i_op = &sdcardfs_dir_iops;
+		inode->i_fop = &sdcardfs_dir_fops;
+	} else if (special_file(inode->i_mode)) {
+		inode->i_op = &sdcardfs_main_iops;
+		init_special_inode(inode, inode->i_mode, lower_inode->i_rdev);
+	} else {
+		inode->i_op = &sdcardfs_main_iops;
+		inode->i_fop = &sdcardfs_main_fops;
+	}
+
+	return 0;
+}
+
+struct inode *sdcardfs_iget(struct super_block *sb, struct inode *lower_inode)
+{
+	struct inode *inode;
+
+	if (lower_inode->i_sb != SDCARDFS_SB(sb)->lower_sb)
+		return ERR_PTR(-EXDEV);
+	if (!igrab(lower_inode))
+		return ERR_PTR(-ESTALE);
+
+	inode = iget5_locked(sb, (unsigned long)lower_inode,
+			     sdcardfs_inode_test, sdcardfs_inode_set,
+			     lower_inode);
+	if (!inode) {
+		iput(lower_inode);
+		return ERR_PTR(-ENOMEM);
+	}
+
+	if (inode->i_state & I_NEW)
+		unlock_new_inode(inode);
+	else
+		iput(lower_inode);
+
+	return inode;
+}
+
+/* Upper inode for a dentry whose lower dentry is positive */
+static struct inode *sdcardfs_get_inode(struct dentry *dentry,
+					struct inode *lower_inode)
+{
+	struct inode *inode;
+
+	inode = sdcardfs_iget(dentry->d_sb, lower_inode);
+	if (IS_ERR(inode))
+		return inode;
+
+	sdcardfs_derive_perm(dentry->d_parent->d_inode, inode,
+			     dentry->d_name.name);
+	sdcardfs_update_attr(inode);
+	return inode;
+}
+
+static int sdcardfs_instantiate(struct inode *dir, struct dentry *dentry,
+				struct dentry *lower_dentry)
+{
+	struct inode *inode;
+
+	inode = sdcardfs_get_inode(dentry, lower_dentry->d_inode);
+	if (IS_ERR(inode))
+		return PTR_ERR(inode);
+
+	d_instantiate(dentry, inode);
+	sdcardfs_update_attr(dir);
+	return 0;
+}
+
+static struct dentry *sdcardfs_lookup(struct inode *dir, struct dentry *dentry,
+				      struct nameidata *nd)
+{
+	struct sdcardfs_dentry_info *info;
+	struct path lower_parent_path;
+	struct dentry *lower_dentry;
+	const struct cred *saved_cred;
+	struct inode *inode = NULL;
+	int err;
+
+	err = sdcardfs_new_dentry_private(dentry);
+	if (err)
+		return ERR_PTR(err);
+	info = SDCARDFS_D(dentry);
+
+	sdcardfs_get_lower_path(dentry->d_parent, &lower_parent_path);
+
+	saved_cred = sdcardfs_override_creds(dir->i_sb);
+	mutex_lock(&lower_parent_path.dentry->d_inode->i_mutex);
+	lower_dentry = lookup_one_len(dentry->d_name.name,
+				      lower_parent_path.dentry,
+				      dentry->d_name.len);
+	mutex_unlock(&lower_parent_path.dentry->d_inode->i_mutex);
+	revert_creds(saved_cred);
+
+	if (IS_ERR(lower_dentry)) {
+		err = PTR_ERR(lower_dentry);
+		goto out;
+	}
+
+	info->lower_path.dentry = lower_dentry;
+	info->lower_path.mnt = mntget(lower_parent_path.mnt);
+
+	if (lower_dentry->d_inode) {
+		inode = sdcardfs_get_inode(dentry, lower_dentry->d_inode);
+		if (IS_ERR(inode)) {
+			err = PTR_ERR(inode);
+			goto out;
+		}
+	}
+
+	fsstack_copy_attr_atime(dir, lower_parent_path.dentry->d_inode);
+	path_put(&lower_parent_path);
+	d_add(dentry, inode);
+	return NULL;
+
+out:
+	path_put(&lower_parent_path);
+	sdcardfs_free_dentry_private(dentry);
+	return ERR_PTR(err);
+}
+
+/*
+ * Like the sdcard daemon, files and directories are always created with
+ * the same lower mode; what others see is derived anyway.
+ */
+static int sdcardfs_create(struct inode *dir, struct dentry *dentry, int mode,
+			   struct nameidata *nd)
+{
+	struct path lower_path;
+	struct dentry *lower_dir;
+	const struct cred *saved_cred;
+	int err;
+
+	sdcardfs_get_lower_path(dentry, &lower_path);
+	saved_cred = sdcardfs_override_creds(dir->i_sb);
+	lower_dir = lock_parent(lower_path.dentry);
+
+	err = vfs_create(lower_dir->d_inode, lower_path.dentry, 0664, NULL);
+	if (!err)
+		err = sdcardfs_instantiate(dir, dentry, lower_path.dentry);
+
+	unlock_dir(lower_dir);
+	revert_creds(saved_cred);
+	path_put(&lower_path);
+	return err;
+}
+
+static int sdcardfs_mkdir(struct inode *dir, struct dentry *dentry, int mode)
+{
+	struct path lower_path;
+	struct dentry *lower_dir;
+	const struct cred *saved_cred;
+	int err;
+
+	sdcardfs_get_lower_path(dentry, &lower_path);
+	saved_cred = sdcardfs_override_creds(dir->i_sb);
+	lower_dir = lock_parent(lower_path.dentry);
+
+	err = vfs_mkdir(lower_dir->d_inode, lower_path.dentry, 0775);
+	if (!err)
+		err = sdcardfs_instantiate(dir, dentry, lower_path.dentry);
+
+	unlock_dir(lower_dir);
+	revert_creds(saved_cred);
+	path_put(&lower_path);
+	return err;
+}
+
+static int sdcardfs_unlink(struct inode *dir, struct dentry *dentry)
+{
+	struct inode *inode = dentry->d_inode;
+	struct path lower_path;
+	struct dentry *lower_dir;
+	const struct cred *saved_cred;
+	int err;
+
+	sdcardfs_get_lower_path(dentry, &lower_path);
+	saved_cred = sdcardfs_override_creds(dir->i_sb);
+	lower_dir = lock_parent(lower_path.dentry);
+
+	err = vfs_unlink(lower_dir->d_inode, lower_path.dentry);
+	if (!err) {
+		sdcardfs_update_attr(dir);
+		inode->i_nlink = sdcardfs_lower_inode(inode)->i_nlink;
+		inode->i_ctime = dir->i_ctime;
+		d_drop(dentry);
+	}
+
+	unlock_dir(lower_dir);
+	revert_creds(saved_cred);
+	path_put(&lower_path);
+	return err;
+}
+
+static int sdcardfs_rmdir(struct inode *dir, struct dentry *dentry)
+{
+	struct path lower_path;
+	struct dentry *lower_dir;
+	const struct cred *saved_cred;
+	int err;
+
+	sdcardfs_get_lower_path(dentry, &lower_path);
+	saved_cred = sdcardfs_override_creds(dir->i_sb);
+	lower_dir = lock_parent(lower_path.dentry);
+
+	err = vfs_rmdir(lower_dir->d_inode, lower_path.dentry);
+	if (!err) {
+		clear_nlink(dentry->d_inode);
+		sdcardfs_update_attr(dir);
+		d_drop(dentry);
+	}
+
+	unlock_dir(lower_dir);
+	revert_creds(saved_cred);
+	path_put(&lower_path);
+	return err;
+}
+
+/*
+ * The derived owner of the moved tree is refreshed by d_revalidate() on
+ * the next lookup, so nothing has to be walked here.
+ */
+static int sdcardfs_rename(struct inode *old_dir, struct dentry *old_dentry,
+			   struct inode *new_dir, struct dentry *new_dentry)
+{
+	struct path lower_old_path, lower_new_path;
+	struct dentry *lower_old_dir, *lower_new_dir;
+	const struct cred *saved_cred;
+	struct dentry *trap;
+	int err;
+
+	sdcardfs_get_lower_path(old_dentry, &lower_old_path);
+	sdcardfs_get_lower_path(new_dentry, &lower_new_path);
+	lower_old_dir = dget_parent(lower_old_path.dentry);
+	lower_new_dir = dget_parent(lower_new_path.dentry);
+
+	saved_cred = sdcardfs_override_creds(old_dir->i_sb);
+	trap = lock_rename(lower_old_dir, lower_new_dir);
+	/* source should not be ancestor of target */
+	if (trap == lower_old_path.dentry) {
+		err = -EINVAL;
+		goto out;
+	}
+	/* target should not be ancestor of source */
+	if (trap == lower_new_path.dentry) {
+		err = -ENOTEMPTY;
+		goto out;
+	}
+
+	err = vfs_rename(lower_old_dir->d_inode, lower_old_path.dentry,
+			 lower_new_dir->d_inode, lower_new_path.dentry);
+	if (!err) {
+		sdcardfs_update_attr(new_dir);
+		if (new_dir != old_dir)
+			sdcardfs_update_attr(old_dir);
+	}
+
+out:
+	unlock_rename(lower_old_dir, lower_new_dir);
+	revert_creds(saved_cred);
+	dput(lower_new_dir);
+	dput(lower_old_dir);
+	path_put(&lower_new_path);
+	path_put(&lower_old_path);
+	return err;
+}
+
+/*
+ * Only the derived attributes decide, the lower filesystem is always
+ * accessed as its owner.
+ */
+static int sdcardfs_permission(struct inode *inode, int mask,
+			       unsigned int flags)
+{
+	return generic_permission(inode, mask, flags, NULL);
+}
+
+static int sdcardfs_setattr(struct dentry *dentry, struct iattr *ia)
+{
+	struct inode *inode = dentry->d_inode;
+	struct path lower_path;
+	struct iattr lower_ia;
+	const struct cred *saved_cred;
+	int err;
+
+	/* Owner and mode are derived, changes to them are ignored */
+	ia->ia_valid &= ~(ATTR_UID | ATTR_GID | ATTR_MODE |
+			  ATTR_KILL_SUID | ATTR_KILL_SGID);
+
+	err = inode_change_ok(inode, ia);
+	if (err)
+		return err;
+
+	memcpy(&lower_ia, ia, sizeof(lower_ia));
+	if (!(lower_ia.ia_valid & ~ATTR_FORCE))
+		return 0;
+	if (ia->ia_valid & ATTR_FILE)
+		lower_ia.ia_file = sdcardfs_lower_file(ia->ia_file);
+
+	sdcardfs_get_lower_path(dentry, &lower_path);
+	saved_cred = sdcardfs_override_creds(dentry->d_sb);
+	mutex_lock(&lower_path.dentry->d_inode->i_mutex);
+	err = notify_change(lower_path.dentry, &lower_ia);
+	mutex_unlock(&lower_path.dentry->d_inode->i_mutex);
+	revert_creds(saved_cred);
+	path_put(&lower_path);
+
+	sdcardfs_update_attr(inode);
+	return err;
+}
+
+static int sdcardfs_getattr(struct vfsmount *mnt, struct dentry *dentry,
+			    struct kstat *stat)
+{
+	struct path lower_path;
+	struct kstat lower_stat;
+	const struct cred *saved_cred;
+	int err;
+
+	sdcardfs_get_lower_path(dentry, &lower_path);
+	saved_cred = sdcardfs_override_creds(dentry->d_sb);
+	err = vfs_getattr(lower_path.mnt, lower_path.dentry, &lower_stat);
+	revert_creds(saved_cred);
+	path_put(&lower_path);
+	if (err)
+		return err;
+
+	sdcardfs_update_attr(dentry->d_inode);
+	generic_fillattr(dentry->d_inode, stat);
+	stat->blocks = lower_stat.blocks;
+	return 0;
+}
+
+const struct inode_operations sdcardfs_dir_iops = {
+	.create		= sdcardfs_create,
+	.lookup		= sdcardfs_lookup,
+	.unlink		= sdcardfs_unlink,
+	.mkdir		= sdcardfs_mkdir,
+	.rmdir		= sdcardfs_rmdir,
+	.rename		= sdcardfs_rename,
+	.permission	= sdcardfs_permission,
+	.setattr	= sdcardfs_setattr,
+	.getattr	= sdcardfs_getattr,
+};
+
+const struct inode_operations sdcardfs_main_iops = {
+	.permission	= sdcardfs_permission,
+	.setattr	= sdcardfs_setattr,
+	.getattr	= sdcardfs_getattr,
+};
@@ -0,0 +1,320 @@
+/* Copyright (c) 2012, Code Aurora Forum. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+/*
+ * sdcardfs shows a directory of the internal storage (usually /data/media)
+ * as the emulated external storage, with FAT like ownership, in place of
+ * the userspace sdcard FUSE daemon:
+ *
+ *	mount -t sdcardfs -o uid=1023,gid=1015,derive /data/media /mnt/shell/emulated
+ */
+
+#include <linux/module.h>
+#include <linux/init.h>
+#include <linux/fs.h>
+#include <linux/magic.h>
+#include <linux/mount.h>
+#include <linux/namei.h>
+#include <linux/parser.h>
+#include <linux/slab.h>
+
+#include "sdcardfs.h"
+
+enum {
+	Opt_uid, Opt_gid, Opt_lower_uid, Opt_lower_gid, Opt_mask, Opt_derive,
+	Opt_err
+};
+
+static const match_table_t sdcardfs_tokens = {
+	{Opt_uid, "uid=%u"},
+	{Opt_gid, "gid=%u"},
+	{Opt_lower_uid, "lower_uid=%u"},
+	{Opt_lower_gid, "lower_gid=%u"},
+	{Opt_mask, "mask=%o"},
+	{Opt_derive, "derive"},
+	{Opt_err, NULL}
+};
+
+static int sdcardfs_parse_options(struct sdcardfs_mount_options *opts,
+				  char *options)
+{
+	substring_t args[MAX_OPT_ARGS];
+	char *p;
+	int option;
+
+	opts->fs_uid = AID_MEDIA_RW;
+	opts->fs_gid = AID_SDCARD_RW;
+	opts->lower_uid = AID_MEDIA_RW;
+	opts->lower_gid = AID_MEDIA_RW;
+	opts->mask = 0;
+	opts->derive = false;
+
+	if (!options)
+		return 0;
+
+	while ((p = strsep(&options, ",")) != NULL) {
+		int token;
+
+		if (!*p)
+			continue;
+
+		token = match_token(p, sdcardfs_tokens, args);
+		switch (token) {
+		case Opt_uid:
+			if (match_int(&args[0], &option))
+				return -EINVAL;
+			opts->fs_uid = option;
+			break;
+		case Opt_gid:
+			if (match_int(&args[0], &option))
+				return -EINVAL;
+			opts->fs_gid = option;
+			break;
+		case Opt_lower_uid:
+			if (match_int(&args[0], &option))
+				return -EINVAL;
+			opts->lower_uid = option;
+			break;
+		case Opt_lower_gid:
+			if (match_int(&args[0], &option))
+				return -EINVAL;
+			opts->lower_gid = option;
+			break;
+		case Opt_mask:
+			if (match_octal(&args[0], &option))
+				return -EINVAL;
+			opts->mask = option & S_IRWXUGO;
+			break;
+		case Opt_derive:
+			opts->derive = true;
+			break;
+		default:
+			printk(KERN_ERR "%s: unrecognized mount option \"%s\"\n",
+			       SDCARDFS_NAME, p);
+			return -EINVAL;
+		}
+	}
+	return 0;
+}
+
+static void sdcardfs_free_sb_info(struct sdcardfs_sb_info *sbi)
+{
+	bdi_destroy(&sbi->bdi);
+	put_cred(sbi->lower_cred);
+	kfree(sbi);
+}
+
+static struct dentry *sdcardfs_mount(struct file_system_type *fs_type,
+				     int flags, const char *dev_name,
+				     void *raw_data)
+{
+	struct sdcardfs_sb_info *sbi;
+	struct super_block *s;
+	struct inode *inode;
+	struct cred *cred;
+	struct path path;
+	int err;
+
+	if (!dev_name)
+		return ERR_PTR(-EINVAL);
+
+	sbi = kzalloc(sizeof(*sbi), GFP_KERNEL);
+	if (!sbi)
+		return ERR_PTR(-ENOMEM);
+
+	err = sdcardfs_parse_options(&sbi->options, raw_data);
+	if (err)
+		goto out_free;
+
+	/*
+	 * Everything on the lower filesystem is done as its owner, without
+	 * the capabilities of whoever mounted us, so that permissions and
+	 * reserved blocks are enforced as they were for the sdcard daemon.
+	 */
+	cred = prepare_creds();
+	if (!cred) {
+		err = -ENOMEM;
+		goto out_free;
+	}
+	cred->fsuid = sbi->options.lower_uid;
+	cred->fsgid = sbi->options.lower_gid;
+	cap_clear(cred->cap_inheritable);
+	cap_clear(cred->cap_permitted);
+	cap_clear(cred->cap_effective);
+	sbi->lower_cred = cred;
+
+	err = bdi_setup_and_register(&sbi->bdi, SDCARDFS_NAME, 0);
+	if (err)
+		goto out_cred;
+
+	err = kern_path(dev_name, LOOKUP_FOLLOW | LOOKUP_DIRECTORY, &path);
+	if (err)
+		goto out_bdi;
+
+	if (path.dentry->d_sb->s_type == fs_type) {
+		printk(KERN_ERR "%s: cannot be mounted on top of itself\n",
+		       SDCARDFS_NAME);
+		err = -EINVAL;
+		goto out_path;
+	}
+
+	s = sget(fs_type, NULL, set_anon_super, NULL);
+	if (IS_ERR(s)) {
+		err = PTR_ERR(s);
+		goto out_path;
+	}
+
+	/* From here on sdcardfs_kill_sb() frees sbi */
+	sbi->lower_sb = path.dentry->d_sb;
+	s->s_fs_info = sbi;
+	s->s_flags = flags;
+	s->s_bdi = &sbi->bdi;
+	s->s_op = &sdcardfs_sops;
+	s->s_d_op = &sdcardfs_dops;
+	s->s_magic = SDCARDFS_SUPER_MAGIC;
+	s->s_maxbytes = path.dentry->d_sb->s_maxbytes;
+	s->s_blocksize = path.dentry->d_sb->s_blocksize;
+	s->s_blocksize_bits = path.dentry->d_sb->s_blocksize_bits;
+	s->s_time_gran = path.dentry->d_sb->s_time_gran;
+
+	inode = sdcardfs_iget(s, path.dentry->d_inode);
+	if (IS_ERR(inode)) {
+		err = PTR_ERR(inode);
+		goto out_super;
+	}
+	sdcardfs_init_root_perm(inode);
+	sdcardfs_update_attr(inode);
+
+	s->s_root = d_alloc_root(inode);
+	if (!s->s_root) {
+		iput(inode);
+		err = -ENOMEM;
+		goto out_super;
+	}
+
+	err = sdcardfs_new_dentry_private(s->s_root);
+	if (err)
+		goto out_super;
+	SDCARDFS_D(s->s_root)->lower_path = path;
+
+	s->s_flags |= MS_ACTIVE;
+	return dget(s->s_root);
+
+out_super:
+	path_put(&path);
+	deactivate_locked_super(s);
+	return ERR_PTR(err);
+out_path:
+	path_put(&path);
+out_bdi:
+	bdi_destroy(&sbi->bdi);
+out_cred:
+	put_cred(sbi->lower_cred);
+out_free:
+	kfree(sbi);
+	return ERR_PTR(err);
+}
+
+static void sdcardfs_kill_sb(struct super_block *sb)
+{
+	struct sdcardfs_sb_info *sbi = SDCARDFS_SB(sb);
+
+	kill_anon_super(sb);
+	sdcardfs_free_sb_info(sbi);
+}
+
+static struct file_system_type sdcardfs_fs_type = {
+	.owner		= THIS_MODULE,
+	.name		= SDCARDFS_NAME,
+	.mount		= sdcardfs_mount,
+	.kill_sb	= sdcardfs_kill_sb,
+	.fs_flags	= 0
+};
+
+static void sdcardfs_inode_init_once(void *vptr)
+{
+	struct sdcardfs_inode_info *info = vptr;
+
+	inode_init_once(&info->vfs_inode);
+}
+
+static void sdcardfs_free_caches(void)
+{
+	/* Make sure all delayed rcu free inodes are flushed */
+	rcu_barrier();
+
+	if (sdcardfs_inode_cachep)
+		kmem_cache_destroy(sdcardfs_inode_cachep);
+	if (sdcardfs_dentry_cachep)
+		kmem_cache_destroy(sdcardfs_dentry_cachep);
+	if (sdcardfs_file_cachep)
+		kmem_cache_destroy(sdcardfs_file_cachep);
+}
+
+static int __init sdcardfs_init_caches(void)
+{
+	sdcardfs_inode_cachep = kmem_cache_create("sdcardfs_inode_cache",
+				sizeof(struct sdcardfs_inode_info), 0,
+				SLAB_RECLAIM_ACCOUNT | SLAB_MEM_SPREAD,
+				sdcardfs_inode_init_once);
+	sdcardfs_dentry_cachep = kmem_cache_create("sdcardfs_dentry_cache",
+				sizeof(struct sdcardfs_dentry_info), 0,
+				SLAB_RECLAIM_ACCOUNT, NULL);
+	sdcardfs_file_cachep = kmem_cache_create("sdcardfs_file_cache",
+				sizeof(struct sdcardfs_file_info), 0,
+				0, NULL);
+
+	if (!sdcardfs_inode_cachep || !sdcardfs_dentry_cachep ||
+	    !sdcardfs_file_cachep) {
+		sdcardfs_free_caches();
+		return -ENOMEM;
+	}
+	return 0;
+}
+
+static int __init init_sdcardfs_fs(void)
+{
+	int err;
+
+	err = sdcardfs_init_caches();
+	if (err)
+		return err;
+
+	err = sdcardfs_packages_init();
+	if (err)
+		goto out_caches;
+
+	err = register_filesystem(&sdcardfs_fs_type);
+	if (err)
+		goto out_packages;
+	return 0;
+
+out_packages:
+	sdcardfs_packages_exit();
+out_caches:
+	sdcardfs_free_caches();
+	return err;
+}
+
+static void __exit exit_sdcardfs_fs(void)
+{
+	unregister_filesystem(&sdcardfs_fs_type);
+	sdcardfs_packages_exit();
+	sdcardfs_free_caches();
+}
+
+MODULE_DESCRIPTION("Stacked filesystem for Android external storage");
+MODULE_LICENSE("GPL v2");
+
+module_init(init_sdcardfs_fs);
+module_exit(exit_sdcardfs_fs);
@@ -0,0 +1,215 @@
+/* Copyright (c) 2012, Code Aurora Forum. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+/*
+ * Package name to app id map used to derive the owner of app private
+ * directories. The package manager keeps it in sync through
+ * /proc/fs/sdcardfs/packages, one "<package> <appid>" per line. An appid
+ * of 0 removes the package.
+ */
+
+#include <linux/kernel.h>
+#include <linux/ctype.h>
+#include <linux/mutex.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+#include <linux/list.h>
+#include <linux/rculist.h>
+#include <linux/dcache.h>
+#include <linux/proc_fs.h>
+#include <linux/seq_file.h>
+#include <linux/uaccess.h>
+
+#include "sdcardfs.h"
+
+#define SDCARDFS_PKG_HASH_BITS	7
+#define SDCARDFS_PKG_HASH_SIZE	(1 << SDCARDFS_PKG_HASH_BITS)
+#define SDCARDFS_PKG_NAME_MAX	128
+
+struct sdcardfs_package {
+	struct hlist_node node;
+	struct rcu_head rcu;
+	uid_t appid;
+	char name[0];
+};
+
+static struct hlist_head sdcardfs_pkg_hash[SDCARDFS_PKG_HASH_SIZE];
+/* Serializes updates, lookups only take rcu_read_lock() */
+static DEFINE_MUTEX(sdcardfs_pkg_lock);
+static struct proc_dir_entry *sdcardfs_proc_dir;
+
+/* Package names are matched case insensitively, like the sdcard itself */
+static unsigned int sdcardfs_pkg_hash_fn(const char *name)
+{
+	unsigned long hash = init_name_hash();
+
+	while (*name)
+		hash = partial_name_hash(tolower(*name++), hash);
+	return end_name_hash(hash) & (SDCARDFS_PKG_HASH_SIZE - 1);
+}
+
+static struct sdcardfs_package *sdcardfs_pkg_find(const char *name,
+		unsigned int hash)
+{
+	struct sdcardfs_package *pkg;
+	struct hlist_node *pos;
+
+	hlist_for_each_entry_rcu(pkg, pos, &sdcardfs_pkg_hash[hash], node) {
+		if (!strcasecmp(pkg->name, name))
+			return pkg;
+	}
+	return NULL;
+}
+
+uid_t sdcardfs_package_appid(const char *name)
+{
+	struct sdcardfs_package *pkg;
+	uid_t appid = 0;
+
+	rcu_read_lock();
+	pkg = sdcardfs_pkg_find(name, sdcardfs_pkg_hash_fn(name));
+	if (pkg)
+		appid = pkg->appid;
+	rcu_read_unlock();
+
+	return appid;
+}
+
+static int sdcardfs_pkg_set(const char *name, uid_t appid)
+{
+	unsigned int hash = sdcardfs_pkg_hash_fn(name);
+	struct sdcardfs_package *pkg, *new = NULL;
+
+	if (appid) {
+		new = kmalloc(sizeof(*new) + strlen(name) + 1, GFP_KERNEL);
+		if (!new)
+			return -ENOMEM;
+		new->appid = appid;
+		strcpy(new->name, name);
+	}
+
+	mutex_lock(&sdcardfs_pkg_lock);
+	pkg = sdcardfs_pkg_find(name, hash);
+	if (pkg && new)
+		hlist_replace_rcu(&pkg->node, &new->node);
+	else if (pkg)
+		hlist_del_rcu(&pkg->node);
+	else if (new)
+		hlist_add_head_rcu(&new->node, &sdcardfs_pkg_hash[hash]);
+	mutex_unlock(&sdcardfs_pkg_lock);
+
+	if (pkg)
+		kfree_rcu(pkg, rcu);
+	return 0;
+}
+
+static int sdcardfs_packages_show(struct seq_file *m, void *unused)
+{
+	struct sdcardfs_package *pkg;
+	struct hlist_node *pos;
+	int i;
+
+	mutex_lock(&sdcardfs_pkg_lock);
+	for (i = 0; i < SDCARDFS_PKG_HASH_SIZE; i++)
+		hlist_for_each_entry(pkg, pos, &sdcardfs_pkg_hash[i], node)
+			seq_printf(m, "%s %u\n", pkg->name, pkg->appid);
+	mutex_unlock(&sdcardfs_pkg_lock);
+
+	return 0;
+}
+
+static int sdcardfs_packages_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, sdcardfs_packages_show, NULL);
+}
+
+static ssize_t sdcardfs_packages_write(struct file *file,
+		const char __user *buf, size_t count, loff_t *ppos)
+{
+	char line[SDCARDFS_PKG_NAME_MAX + 16];
+	char name[SDCARDFS_PKG_NAME_MAX];
+	size_t done = 0;
+	unsigned int appid;
+	int err;
+
+	while (done < count) {
+		size_t len = min(count - done, sizeof(line) - 1);
+		char *end;
+
+		if (copy_from_user(line, buf + done, len))
+			return -EFAULT;
+		line[len] = '\0';
+
+		end = strchr(line, '\n');
+		if (end) {
+			*end = '\0';
+			len = end - line + 1;
+		} else if (done + len < count) {
+			/* Line too long */
+			return -EINVAL;
+		}
+
+		if (sscanf(line, "%127s %u", name, &appid) != 2)
+			return -EINVAL;
+		err = sdcardfs_pkg_set(name, appid);
+		if (err)
+			return err;
+
+		done += len;
+	}
+
+	return count;
+}
+
+static const struct file_operations sdcardfs_packages_fops = {
+	.open		= sdcardfs_packages_open,
+	.read		= seq_read,
+	.write		= sdcardfs_packages_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+int sdcardfs_packages_init(void)
+{
+	sdcardfs_proc_dir = proc_mkdir("fs/" SDCARDFS_NAME, NULL);
+	if (!sdcardfs_proc_dir)
+		return -ENOMEM;
+
+	if (!proc_create("packages", S_IRUSR | S_IWUSR, sdcardfs_proc_dir,
+			 &sdcardfs_packages_fops)) {
+		remove_proc_entry("fs/" SDCARDFS_NAME, NULL);
+		return -ENOMEM;
+	}
+
+	return 0;
+}
+
+void sdcardfs_packages_exit(void)
+{
+	struct sdcardfs_package *pkg;
+	struct hlist_node *pos, *n;
+	int i;
+
+	remove_proc_entry("packages", sdcardfs_proc_dir);
+	remove_proc_entry("fs/" SDCARDFS_NAME, NULL);
+
+	mutex_lock(&sdcardfs_pkg_lock);
+	for (i = 0; i < SDCARDFS_PKG_HASH_SIZE; i++) {
+		hlist_for_each_entry_safe(pkg, pos, n, &sdcardfs_pkg_hash[i],
+					  node) {
+			hlist_del_rcu(&pkg->node);
+			kfree_rcu(pkg, rcu);
+		}
+	}
+	mutex_unlock(&sdcardfs_pkg_lock);
+}
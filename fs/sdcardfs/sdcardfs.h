@@ -0,0 +1,152 @@
+/* Copyright (c) 2012, Code Aurora Forum. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#ifndef _SDCARDFS_H_
+#define _SDCARDFS_H_
+
+#include <linux/fs.h>
+#include <linux/path.h>
+#include <linux/cred.h>
+#include <linux/backing-dev.h>
+
+#define SDCARDFS_NAME	"sdcardfs"
+
+/* Android ids, see system/core/include/private/android_filesystem_config.h */
+#define AID_SDCARD_RW	1015
+#define AID_MEDIA_RW	1023
+
+/*
+ * How the owner of a node is derived from its place in the tree. Only the
+ * top few levels are special, everything else inherits from the parent.
+ */
+enum sdcardfs_perm {
+	PERM_INHERIT,		/* same owner as the parent */
+	PERM_ROOT,		/* the top of the tree */
+	PERM_ANDROID,		/* /Android */
+	PERM_ANDROID_DATA,	/* /Android/data */
+	PERM_ANDROID_OBB,	/* /Android/obb */
+	PERM_ANDROID_PACKAGE,	/* /Android/{data,obb}/<package> */
+};
+
+struct sdcardfs_mount_options {
+	uid_t fs_uid;		/* owner shown for the tree */
+	gid_t fs_gid;		/* group shown for the tree */
+	uid_t lower_uid;	/* fsuid used on the lower filesystem */
+	gid_t lower_gid;	/* fsgid used on the lower filesystem */
+	umode_t mask;		/* bits removed from the shown modes */
+	bool derive;		/* derive owners of app private dirs */
+};
+
+struct sdcardfs_sb_info {
+	struct super_block *lower_sb;
+	struct sdcardfs_mount_options options;
+	/* Credentials all lower filesystem operations run with */
+	const struct cred *lower_cred;
+	struct backing_dev_info bdi;
+};
+
+struct sdcardfs_inode_info {
+	struct inode *lower_inode;
+	enum sdcardfs_perm perm;
+	uid_t d_uid;
+	/* Somewhere under an app private directory */
+	bool app_private;
+	struct inode vfs_inode;
+};
+
+struct sdcardfs_dentry_info {
+	struct path lower_path;
+};
+
+struct sdcardfs_file_info {
+	struct file *lower_file;
+};
+
+extern const struct file_operations sdcardfs_main_fops;
+extern const struct file_operations sdcardfs_dir_fops;
+extern const struct inode_operations sdcardfs_main_iops;
+extern const struct inode_operations sdcardfs_dir_iops;
+extern const struct super_operations sdcardfs_sops;
+extern const struct dentry_operations sdcardfs_dops;
+
+extern struct kmem_cache *sdcardfs_inode_cachep;
+extern struct kmem_cache *sdcardfs_dentry_cachep;
+extern struct kmem_cache *sdcardfs_file_cachep;
+
+static inline struct sdcardfs_sb_info *SDCARDFS_SB(struct super_block *sb)
+{
+	return sb->s_fs_info;
+}
+
+static inline struct sdcardfs_inode_info *SDCARDFS_I(struct inode *inode)
+{
+	return container_of(inode, struct sdcardfs_inode_info, vfs_inode);
+}
+
+static inline struct inode *sdcardfs_lower_inode(struct inode *inode)
+{
+	return SDCARDFS_I(inode)->lower_inode;
+}
+
+static inline struct sdcardfs_dentry_info *SDCARDFS_D(struct dentry *dentry)
+{
+	return dentry->d_fsdata;
+}
+
+/* Takes a reference on the lower path, drop it with path_put() */
+static inline void sdcardfs_get_lower_path(struct dentry *dentry,
+					   struct path *lower_path)
+{
+	*lower_path = SDCARDFS_D(dentry)->lower_path;
+	path_get(lower_path);
+}
+
+static inline struct dentry *sdcardfs_lower_dentry(struct dentry *dentry)
+{
+	return SDCARDFS_D(dentry)->lower_path.dentry;
+}
+
+static inline struct file *sdcardfs_lower_file(struct file *file)
+{
+	return ((struct sdcardfs_file_info *)file->private_data)->lower_file;
+}
+
+/*
+ * Switch to the lower owner for an operation on the lower filesystem.
+ * Access was already checked against the derived attributes.
+ */
+static inline const struct cred *sdcardfs_override_creds(
+		struct super_block *sb)
+{
+	return override_creds(SDCARDFS_SB(sb)->lower_cred);
+}
+
+/* inode.c */
+struct inode *sdcardfs_iget(struct super_block *sb, struct inode *lower_inode);
+
+/* dentry.c */
+int sdcardfs_new_dentry_private(struct dentry *dentry);
+void sdcardfs_free_dentry_private(struct dentry *dentry);
+
+/* derived_perm.c */
+void sdcardfs_init_root_perm(struct inode *inode);
+void sdcardfs_derive_perm(struct inode *parent, struct inode *inode,
+			  const char *name);
+void sdcardfs_update_attr(struct inode *inode);
+
+/* packages.c */
+uid_t sdcardfs_package_appid(const char *name);
+int sdcardfs_packages_init(void);
+void sdcardfs_packages_exit(void);
+
+#endif /* _SDCARDFS_H_ */
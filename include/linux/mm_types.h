@@ -215,6 +215,7 @@ enum {
 	MM_FILEPAGES,
 	MM_ANONPAGES,
 	MM_SWAPENTS,
+	MM_UNRECLAIMABLE,	/* driver buffers (GPU, ION) owned by this mm */
 	NR_MM_COUNTERS
 };
 
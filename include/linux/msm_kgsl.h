@@ -508,6 +508,92 @@ struct kgsl_timestamp_event_genlock {
 #define IOCTL_KGSL_SETPROPERTY \
 	_IOW(KGSL_IOC_TYPE, 0x32, struct kgsl_device_getproperty)
 
+/* Performance counter groups */
+
+#define KGSL_PERFCOUNTER_GROUP_CP 0x0
+#define KGSL_PERFCOUNTER_GROUP_RBBM 0x1
+#define KGSL_PERFCOUNTER_GROUP_PC 0x2
+#define KGSL_PERFCOUNTER_GROUP_VFD 0x3
+#define KGSL_PERFCOUNTER_GROUP_HLSQ 0x4
+#define KGSL_PERFCOUNTER_GROUP_VPC 0x5
+#define KGSL_PERFCOUNTER_GROUP_TSE 0x6
+#define KGSL_PERFCOUNTER_GROUP_RAS 0x7
+#define KGSL_PERFCOUNTER_GROUP_UCHE 0x8
+#define KGSL_PERFCOUNTER_GROUP_TP 0x9
+#define KGSL_PERFCOUNTER_GROUP_SP 0xA
+#define KGSL_PERFCOUNTER_GROUP_RB 0xB
+#define KGSL_PERFCOUNTER_GROUP_PWR 0xC
+#define KGSL_PERFCOUNTER_GROUP_MAX 0xD
+
+/*
+ * Reserve a performance counter for the given countable. If another user
+ * already counts the same countable the counter is shared. On success
+ * offset holds the register offset of the low dword of the counter, the
+ * high dword immediately follows it.
+ */
+
+struct kgsl_perfcounter_get {
+	unsigned int groupid;
+	unsigned int countable;
+	unsigned int offset;
+	unsigned int __pad[2]; /* For future binary compatibility */
+};
+
+#define IOCTL_KGSL_PERFCOUNTER_GET \
+	_IOWR(KGSL_IOC_TYPE, 0x38, struct kgsl_perfcounter_get)
+
+/* Release a reservation taken with IOCTL_KGSL_PERFCOUNTER_GET */
+
+struct kgsl_perfcounter_put {
+	unsigned int groupid;
+	unsigned int countable;
+	unsigned int __pad[2]; /* For future binary compatibility */
+};
+
+#define IOCTL_KGSL_PERFCOUNTER_PUT \
+	_IOW(KGSL_IOC_TYPE, 0x39, struct kgsl_perfcounter_put)
+
+/*
+ * Read the current 64 bit value of a list of reserved counters. Counters
+ * are reset whenever the GPU is power collapsed, so values are only
+ * meaningful as differences within a period of activity.
+ */
+
+struct kgsl_perfcounter_read_group {
+	unsigned int groupid;
+	unsigned int countable;
+	uint64_t value;
+};
+
+struct kgsl_perfcounter_read {
+	struct kgsl_perfcounter_read_group *reads;
+	unsigned int count;
+	unsigned int __pad[2]; /* For future binary compatibility */
+};
+
+#define IOCTL_KGSL_PERFCOUNTER_READ \
+	_IOWR(KGSL_IOC_TYPE, 0x3B, struct kgsl_perfcounter_read)
+
+/*
+ * Counters accumulated for a draw context while it was resident on the
+ * GPU. The counters are sampled by the GPU itself on every context switch
+ * while any client holds a KGSL_PERFCOUNTER_GROUP_SP or _TP counter, so
+ * only work that has retired is accounted. dropped counts residencies
+ * that could not be sampled because too many samples were still in flight.
+ */
+
+struct kgsl_drawctxt_perfcounters {
+	unsigned int drawctxt_id;
+	unsigned int dropped;
+	uint64_t busy_cycles;
+	uint64_t alu_active_cycles;
+	uint64_t tex_cache_misses;
+	unsigned int __pad[2]; /* For future binary compatibility */
+};
+
+#define IOCTL_KGSL_DRAWCTXT_PERFCOUNTERS \
+	_IOWR(KGSL_IOC_TYPE, 0x3C, struct kgsl_drawctxt_perfcounters)
+
 #ifdef __KERNEL__
 #ifdef CONFIG_MSM_KGSL_DRM
 int kgsl_gem_obj_addr(int drm_fd, int handle, unsigned long *start,
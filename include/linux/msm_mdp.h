@@ -69,6 +69,9 @@
 						struct msmfb_data)
 #define MSMFB_WRITEBACK_TERMINATE _IO(MSMFB_IOCTL_MAGIC, 155)
 #define MSMFB_MDP_PP _IOWR(MSMFB_IOCTL_MAGIC, 156, struct msmfb_mdp_pp)
+#define MSMFB_WRITEBACK_DEQUEUE_FRAME _IOWR(MSMFB_IOCTL_MAGIC, 157, \
+						struct msmfb_writeback_frame)
+#define MSMFB_OVERLAY_VSYNC_CTRL _IOW(MSMFB_IOCTL_MAGIC, 160, unsigned int)
 #define MSMFB_MIPI_REG_WRITE  _IOW(MSMFB_IOCTL_MAGIC, 162, struct disp_diag_mipi_reg_type)
 #define MSMFB_MIPI_REG_READ   _IOWR(MSMFB_IOCTL_MAGIC, 163, struct disp_diag_mipi_reg_type)
 #define MSMFB_DISPLAY_STANDBY _IOW(MSMFB_IOCTL_MAGIC, 164, unsigned int)
@@ -277,6 +280,21 @@ struct msmfb_writeback_data {
 	struct msmfb_img img;
 };
 
+/*
+ * Dequeued writeback buffer along with the sequence number of the frame
+ * written into it and the CLOCK_MONOTONIC time (in ns) at which the
+ * writeback completed, or 0 if no frame was written (panel off).
+ * MSMFB_WRITEBACK_DEQUEUE_BLOCKING in buf_info.flags selects whether
+ * MSMFB_WRITEBACK_DEQUEUE_FRAME waits for a buffer; the older
+ * MSMFB_WRITEBACK_DEQUEUE_BUFFER always waits.
+ */
+struct msmfb_writeback_frame {
+	struct msmfb_data buf_info;
+	uint32_t seq;
+	uint32_t reserved;
+	uint64_t timestamp;
+};
+
 struct mdp_overlay {
 	struct msmfb_img src;
 	struct mdp_rect src_rect;
@@ -580,6 +598,8 @@ int msm_fb_writeback_queue_buffer(struct fb_info *info,
 		struct msmfb_data *data);
 int msm_fb_writeback_dequeue_buffer(struct fb_info *info,
 		struct msmfb_data *data);
+int msm_fb_writeback_dequeue_frame(struct fb_info *info,
+		struct msmfb_writeback_frame *frame);
 int msm_fb_writeback_stop(struct fb_info *info);
 int msm_fb_writeback_terminate(struct fb_info *info);
 #endif
@@ -0,0 +1,31 @@
+#ifndef _LINUX_PRELOAD_H
+#define _LINUX_PRELOAD_H
+
+#include <linux/types.h>
+#include <linux/compiler.h>
+
+struct file;
+
+#ifdef CONFIG_PRELOAD
+extern int preload_recording;
+extern void __preload_record(struct file *filp, pgoff_t offset,
+			     unsigned long nr);
+
+/*
+ * Note a range of a file the page cache reads, for replaying at the next
+ * boot or app launch. Only costs a test while nothing is being recorded.
+ */
+static inline void preload_record(struct file *filp, pgoff_t offset,
+				  unsigned long nr)
+{
+	if (unlikely(preload_recording))
+		__preload_record(filp, offset, nr);
+}
+#else
+static inline void preload_record(struct file *filp, pgoff_t offset,
+				  unsigned long nr)
+{
+}
+#endif
+
+#endif /* _LINUX_PRELOAD_H */
@@ -18,6 +18,7 @@
 
 #include <linux/list.h>
 #include <linux/ktime.h>
+#include <linux/rbtree.h>
 
 /* A wake_lock prevents the system from entering suspend or other low power
  * states when active. If the type is set to WAKE_LOCK_SUSPEND, the wake_lock
@@ -32,8 +33,12 @@ enum {
 	WAKE_LOCK_TYPE_COUNT
 };
 
+/* Hold time histogram buckets: <1ms, <2ms, <4ms, ... and >= 16.384s */
+#define WAKE_LOCK_HIST_BUCKETS 16
+
 struct wake_lock {
 	struct list_head    link;
+	struct rb_node      expire_node; /* active locks with a timeout */
 	int                 flags;
 	const char         *name;
 	unsigned long       expires;
@@ -46,6 +51,7 @@ struct wake_lock {
 		ktime_t         prevent_suspend_time;
 		ktime_t         max_time;
 		ktime_t         last_time;
+		unsigned int    hold_hist[WAKE_LOCK_HIST_BUCKETS];
 	} stat;
 #endif
 };
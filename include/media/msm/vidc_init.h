@@ -63,6 +63,9 @@ struct video_client_ctx {
 };
 
 void __iomem *vidc_get_ioaddr(void);
+#ifdef VIDC_ENABLE_DBGFS
+struct dentry *vidc_get_debugfs_root(void);
+#endif
 int vidc_load_firmware(void);
 void vidc_release_firmware(void);
 u32 vidc_get_fd_info(struct video_client_ctx *client_ctx,
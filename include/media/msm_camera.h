@@ -200,6 +200,32 @@
 #define MSM_CAM_IOCTL_ISPIF_IO_CFG \
 	_IOR(MSM_CAM_IOCTL_MAGIC, 54, struct ispif_cfg_data *)
 
+#define MSM_CAM_IOCTL_ZSL_CFG \
+	_IOW(MSM_CAM_IOCTL_MAGIC, 55, struct msm_cam_zsl_cfg *)
+
+#define MSM_CAM_IOCTL_ZSL_CLAIM \
+	_IOWR(MSM_CAM_IOCTL_MAGIC, 56, struct msm_cam_zsl_claim *)
+
+#define MSM_ZSL_MAX_DEPTH 8
+
+/* depth 0 turns the zero shutter lag ring off */
+struct msm_cam_zsl_cfg {
+	int32_t image_mode;
+	uint32_t depth;
+};
+
+/*
+ * timestamp is the capture time in nanoseconds, a zero timestamp claims
+ * the most recent frame in the ring
+ */
+struct msm_cam_zsl_claim {
+	int32_t image_mode;
+	uint32_t frame_id;
+	uint64_t timestamp;
+	uint32_t index;
+	uint32_t reserved;
+};
+
 struct msm_mctl_pp_cmd {
 	int32_t  id;
 	uint16_t length;
@@ -304,6 +304,8 @@ int q6asm_set_mute(struct audio_client *ac, int muteflag);
 
 uint64_t q6asm_get_session_time(struct audio_client *ac);
 
+int q6asm_get_session_time_nowait(struct audio_client *ac);
+
 /* Client can set the IO mode to either AIO/SIO mode */
 int q6asm_set_io_mode(struct audio_client *ac, uint32_t mode);
 
@@ -14,6 +14,7 @@
  * (C) 2012 KYOCERA Corporation
  */
 #include <linux/debug_locks.h>
+#include <linux/console.h>
 #include <linux/interrupt.h>
 #include <linux/kmsg_dump.h>
 #include <linux/kallsyms.h>
@@ -123,6 +124,8 @@ NORET_TYPE void panic(const char * fmt, ...)
 
 	bust_spinlocks(0);
 
+	console_flush_on_panic();
+
 	if (!panic_blink)
 		panic_blink = no_blink;
 
@@ -43,6 +43,7 @@
 #include <linux/cpu.h>
 #include <linux/notifier.h>
 #include <linux/rculist.h>
+#include <linux/kthread.h>
 #include <mach/msm_rtb.h>
 #include <asm/uaccess.h>
 
@@ -144,6 +145,28 @@ EXPORT_SYMBOL(console_set_on_cmdline);
 /* Flag: console code may call schedule() */
 static int console_may_schedule;
 
+/*
+ * Work printk() left for the next tick on this cpu: waking up klogd
+ * and/or the console thread. It can't do either itself since it may be
+ * called with scheduler locks held.
+ */
+#define PRINTK_PENDING_WAKEUP	0x01
+#define PRINTK_PENDING_CONSOLE	0x02
+
+static DEFINE_PER_CPU(int, printk_pending);
+
+/*
+ * Console output is normally pushed by this thread instead of by
+ * whoever called printk(), so a slow serial console doesn't add its
+ * latency to interrupt handlers and other hot paths.
+ */
+static struct task_struct *printk_console_task;
+static bool printk_console_defer = true;
+/* Set on panic, the thread may never run again */
+static int printk_console_sync;
+module_param_named(console_defer, printk_console_defer, bool,
+		   S_IRUGO | S_IWUSR);
+
 #ifdef CONFIG_PRINTK
 
 static char __log_buf[__LOG_BUF_LEN];
@@ -868,7 +891,28 @@ static const char recursion_bug_msg [] =
 		KERN_CRIT "BUG: recent printk recursion!\n";
 static int recursion_bug;
 static int new_text_line = 1;
-static char printk_buf[1024];
+
+/*
+ * Messages are formatted into a per-cpu buffer with interrupts off but
+ * without logbuf_lock, so only the copy into log_buf is serialized.
+ */
+struct printk_cpu_buf {
+	char buf[1024];
+	int busy;
+};
+static DEFINE_PER_CPU(struct printk_cpu_buf, printk_cpu_buf);
+
+/*
+ * Leave console output to printk_console_task. Still print from here
+ * when oopsing or panicking, before the thread is running, and once the
+ * system is going down, halted or restarted.
+ */
+static inline int printk_defer_console(void)
+{
+	return printk_console_defer && printk_console_task &&
+		!oops_in_progress && !printk_console_sync &&
+		system_state <= SYSTEM_RUNNING;
+}
 
 int printk_delay_msec __read_mostly;
 
@@ -893,6 +937,8 @@ asmlinkage int vprintk(const char *fmt, va_list args)
 	char *p;
 	size_t plen;
 	char special;
+	struct printk_cpu_buf *pcb;
+	char *printk_buf;
 
 	boot_delay_msec();
 	printk_delay();
@@ -902,10 +948,12 @@ asmlinkage int vprintk(const char *fmt, va_list args)
 	raw_local_irq_save(flags);
 	this_cpu = smp_processor_id();
 
+	pcb = &per_cpu(printk_cpu_buf, this_cpu);
+
 	/*
 	 * Ouch, printk recursed into itself!
 	 */
-	if (unlikely(printk_cpu == this_cpu)) {
+	if (unlikely(printk_cpu == this_cpu || pcb->busy)) {
 		/*
 		 * If a crash is occurring during printk() on this CPU,
 		 * then try to get the crash message out but make sure
@@ -921,18 +969,19 @@ asmlinkage int vprintk(const char *fmt, va_list args)
 	}
 
 	lockdep_off();
-	spin_lock(&logbuf_lock);
-	printk_cpu = this_cpu;
+	pcb->busy = 1;
+	printk_buf = pcb->buf;
 
-	if (recursion_bug) {
-		recursion_bug = 0;
+	if (recursion_bug && xchg(&recursion_bug, 0)) {
 		strcpy(printk_buf, recursion_bug_msg);
 		printed_len = strlen(recursion_bug_msg);
 	}
 	/* Emit the output into the temporary buffer */
 	printed_len += vscnprintf(printk_buf + printed_len,
-				  sizeof(printk_buf) - printed_len, fmt, args);
+				  sizeof(pcb->buf) - printed_len, fmt, args);
 
+	spin_lock(&logbuf_lock);
+	printk_cpu = this_cpu;
 
 	p = printk_buf;
 
@@ -960,7 +1009,7 @@ asmlinkage int vprintk(const char *fmt, va_list args)
 		printed_len = 0;
 		printk_cpu = UINT_MAX;
 		spin_unlock(&logbuf_lock);
-		goto out_restore_lockdep;
+		goto out_restore_buf;
 	}
 
 	/*
@@ -1021,19 +1070,25 @@ asmlinkage int vprintk(const char *fmt, va_list args)
 	}
 
 	/*
-	 * Try to acquire and then immediately release the
-	 * console semaphore. The release will do all the
-	 * actual magic (print out buffers, wake up klogd,
-	 * etc). 
+	 * Normally the console thread gets kicked from the next tick and
+	 * prints the new text. Otherwise try to acquire and then
+	 * immediately release the console semaphore. The release will do
+	 * all the actual magic (print out buffers, wake up klogd, etc).
 	 *
 	 * The console_trylock_for_printk() function
 	 * will release 'logbuf_lock' regardless of whether it
 	 * actually gets the semaphore or not.
 	 */
-	if (console_trylock_for_printk(this_cpu))
+	if (printk_defer_console()) {
+		printk_cpu = UINT_MAX;
+		spin_unlock(&logbuf_lock);
+		__this_cpu_or(printk_pending, PRINTK_PENDING_CONSOLE);
+	} else if (console_trylock_for_printk(this_cpu)) {
 		console_unlock();
+	}
 
-out_restore_lockdep:
+out_restore_buf:
+	pcb->busy = 0;
 	lockdep_on();
 out_restore_irqs:
 	raw_local_irq_restore(flags);
@@ -1205,6 +1260,9 @@ void resume_console(void)
 	down(&console_sem);
 	console_suspended = 0;
 	console_unlock();
+	/* The thread sleeps while the console is suspended */
+	if (printk_console_task)
+		wake_up_process(printk_console_task);
 }
 
 static void __cpuinit console_flush(struct work_struct *work)
@@ -1295,13 +1353,15 @@ int is_console_locked(void)
 	return console_locked;
 }
 
-static DEFINE_PER_CPU(int, printk_pending);
-
 void printk_tick(void)
 {
 	if (__this_cpu_read(printk_pending)) {
-		__this_cpu_write(printk_pending, 0);
-		wake_up_interruptible(&log_wait);
+		int pending = __this_cpu_xchg(printk_pending, 0);
+
+		if (pending & PRINTK_PENDING_CONSOLE)
+			wake_up_process(printk_console_task);
+		if (pending & PRINTK_PENDING_WAKEUP)
+			wake_up_interruptible(&log_wait);
 	}
 }
 
@@ -1315,8 +1375,44 @@ int printk_needs_cpu(int cpu)
 void wake_up_klogd(void)
 {
 	if (waitqueue_active(&log_wait))
-		this_cpu_write(printk_pending, 1);
+		this_cpu_or(printk_pending, PRINTK_PENDING_WAKEUP);
+}
+
+#ifdef CONFIG_PRINTK
+static int printk_console_thread(void *unused)
+{
+	while (!kthread_should_stop()) {
+		set_current_state(TASK_INTERRUPTIBLE);
+		/*
+		 * console_unlock() prints nothing while the console is
+		 * suspended, resume_console() wakes us up again.
+		 */
+		if (ACCESS_ONCE(console_suspended) ||
+		    ACCESS_ONCE(con_start) == ACCESS_ONCE(log_end))
+			schedule();
+		__set_current_state(TASK_RUNNING);
+
+		console_lock();
+		console_unlock();
+	}
+	return 0;
+}
+
+static int __init printk_console_thread_init(void)
+{
+	struct task_struct *task;
+
+	task = kthread_run(printk_console_thread, NULL, "printk");
+	if (IS_ERR(task)) {
+		pr_err("printk: console thread failed to start: %ld\n",
+		       PTR_ERR(task));
+		return PTR_ERR(task);
+	}
+	printk_console_task = task;
+	return 0;
 }
+early_initcall(printk_console_thread_init);
+#endif
 
 /**
  * console_unlock - unlock the console system
@@ -1372,6 +1468,20 @@ void console_unlock(void)
 }
 EXPORT_SYMBOL(console_unlock);
 
+/**
+ * console_flush_on_panic - flush console output from the panicking cpu
+ *
+ * The console thread was stopped with the other cpus and may even hold
+ * console_sem, so print whatever it left behind from here and make the
+ * following printk()s synchronous.
+ */
+void console_flush_on_panic(void)
+{
+	printk_console_sync = 1;
+	console_trylock();
+	console_unlock();
+}
+
 /**
  * console_conditional_schedule - yield the CPU if required
  *
@@ -0,0 +1,641 @@
+/* Copyright (c) 2012, Code Aurora Forum. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+/*
+ * Record and replay of the reads done at boot or at an app launch.
+ *
+ * Left alone, a cold start reads thousands of small files one after the
+ * other, in the order the code happens to need them, and the storage sees
+ * one request at a time. While recording, every range the page cache
+ * reads is noted (merged with the previous range of the same file). The
+ * list is read out of /proc/preload/list and saved by userspace. At the
+ * next start the saved list is written back and replayed: all files are
+ * opened first, then the ranges are sorted by device and block and read
+ * ahead asynchronously, so that the device gets many large requests in
+ * disk order.
+ */
+
+#include <linux/kernel.h>
+#include <linux/init.h>
+#include <linux/fs.h>
+#include <linux/file.h>
+#include <linux/cred.h>
+#include <linux/mm.h>
+#include <linux/pagemap.h>
+#include <linux/blkdev.h>
+#include <linux/dcache.h>
+#include <linux/hash.h>
+#include <linux/kthread.h>
+#include <linux/list.h>
+#include <linux/mutex.h>
+#include <linux/namei.h>
+#include <linux/slab.h>
+#include <linux/sort.h>
+#include <linux/string.h>
+#include <linux/vmalloc.h>
+#include <linux/proc_fs.h>
+#include <linux/seq_file.h>
+#include <linux/uaccess.h>
+#include <linux/preload.h>
+
+#define PRELOAD_MAX_FILES	4096
+#define PRELOAD_MAX_EXTENTS	16384
+#define PRELOAD_HASH_BITS	8
+#define PRELOAD_NONE		(~0U)
+
+enum preload_state {
+	PRELOAD_IDLE,
+	PRELOAD_RECORDING,
+	PRELOAD_REPLAYING,
+};
+
+struct preload_file {
+	/* In preload_hash by inode while recording, by path otherwise */
+	struct hlist_node hash;
+	char *path;
+	/* Key while recording */
+	dev_t dev;
+	unsigned long ino;
+	/* Last extent of the file, ranges are merged into it */
+	unsigned int last;
+	/* Open while replaying */
+	struct file *filp;
+};
+
+struct preload_extent {
+	unsigned int file;
+	pgoff_t start;
+	unsigned long nr;
+	/* Sort keys while replaying */
+	dev_t dev;
+	sector_t block;
+};
+
+struct preload_stats {
+	unsigned long dropped;		/* not recorded, the list was full */
+	unsigned long files_missing;	/* could not be opened at replay */
+	unsigned long pages_requested;
+	unsigned long pages_cached;	/* requested but already in memory */
+	unsigned long pages_read;
+};
+
+int preload_recording __read_mostly;
+
+static DEFINE_MUTEX(preload_lock);
+static enum preload_state preload_state;
+static struct preload_file *preload_files;
+static struct preload_extent *preload_extents;
+static unsigned int preload_nr_files;
+static unsigned int preload_nr_extents;
+static struct hlist_head preload_hash[1 << PRELOAD_HASH_BITS];
+static struct preload_stats preload_stats;
+/* For d_path() while recording, under preload_lock */
+static char preload_path_buf[PATH_MAX];
+
+static int preload_alloc(void)
+{
+	if (preload_files)
+		return 0;
+
+	preload_files = vmalloc(PRELOAD_MAX_FILES * sizeof(*preload_files));
+	preload_extents = vmalloc(PRELOAD_MAX_EXTENTS *
+				  sizeof(*preload_extents));
+	if (!preload_files || !preload_extents) {
+		vfree(preload_files);
+		vfree(preload_extents);
+		preload_files = NULL;
+		preload_extents = NULL;
+		return -ENOMEM;
+	}
+	return 0;
+}
+
+static void preload_clear(void)
+{
+	unsigned int i;
+
+	for (i = 0; i < preload_nr_files; i++)
+		kfree(preload_files[i].path);
+	for (i = 0; i < ARRAY_SIZE(preload_hash); i++)
+		INIT_HLIST_HEAD(&preload_hash[i]);
+
+	vfree(preload_files);
+	vfree(preload_extents);
+	preload_files = NULL;
+	preload_extents = NULL;
+	preload_nr_files = 0;
+	preload_nr_extents = 0;
+}
+
+static struct preload_file *preload_add_file(const char *path,
+					     unsigned int hash)
+{
+	struct preload_file *pf;
+
+	if (preload_nr_files == PRELOAD_MAX_FILES)
+		return NULL;
+
+	pf = &preload_files[preload_nr_files];
+	pf->path = kstrdup(path, GFP_NOFS);
+	if (!pf->path)
+		return NULL;
+	pf->dev = 0;
+	pf->ino = 0;
+	pf->last = PRELOAD_NONE;
+	pf->filp = NULL;
+	hlist_add_head(&pf->hash, &preload_hash[hash]);
+	preload_nr_files++;
+	return pf;
+}
+
+static int preload_add_extent(struct preload_file *pf, pgoff_t start,
+			      unsigned long nr)
+{
+	struct preload_extent *pe;
+
+	if (preload_nr_extents == PRELOAD_MAX_EXTENTS)
+		return -ENOSPC;
+
+	pe = &preload_extents[preload_nr_extents];
+	pe->file = pf - preload_files;
+	pe->start = start;
+	pe->nr = nr;
+	pe->dev = 0;
+	pe->block = 0;
+	pf->last = preload_nr_extents++;
+	return 0;
+}
+
+static unsigned int preload_inode_hash(struct inode *inode)
+{
+	return hash_long(inode->i_ino ^ inode->i_sb->s_dev,
+			 PRELOAD_HASH_BITS);
+}
+
+static struct preload_file *preload_find_inode(struct inode *inode)
+{
+	struct preload_file *pf;
+	struct hlist_node *node;
+
+	hlist_for_each_entry(pf, node,
+			     &preload_hash[preload_inode_hash(inode)], hash)
+		if (pf->ino == inode->i_ino && pf->dev == inode->i_sb->s_dev)
+			return pf;
+	return NULL;
+}
+
+static unsigned int preload_name_hash(const char *path)
+{
+	return hash_32(full_name_hash((const unsigned char *)path,
+				      strlen(path)), PRELOAD_HASH_BITS);
+}
+
+static struct preload_file *preload_find_name(const char *path)
+{
+	struct preload_file *pf;
+	struct hlist_node *node;
+
+	hlist_for_each_entry(pf, node, &preload_hash[preload_name_hash(path)],
+			     hash)
+		if (!strcmp(pf->path, path))
+			return pf;
+	return NULL;
+}
+
+/* Recording is over, the entries are looked up by path from now on */
+static void preload_rehash_names(void)
+{
+	struct preload_file *pf;
+	unsigned int i;
+
+	for (i = 0; i < preload_nr_files; i++) {
+		pf = &preload_files[i];
+		hlist_del(&pf->hash);
+		hlist_add_head(&pf->hash,
+			       &preload_hash[preload_name_hash(pf->path)]);
+	}
+}
+
+static struct preload_file *preload_record_file(struct file *filp)
+{
+	struct inode *inode = filp->f_mapping->host;
+	struct preload_file *pf;
+	char *path;
+
+	/* It has to be possible to open it again by name */
+	if (d_unlinked(filp->f_path.dentry))
+		return NULL;
+	path = d_path(&filp->f_path, preload_path_buf,
+		      sizeof(preload_path_buf));
+	if (IS_ERR(path) || strchr(path, '\n'))
+		return NULL;
+
+	pf = preload_add_file(path, preload_inode_hash(inode));
+	if (pf) {
+		pf->dev = inode->i_sb->s_dev;
+		pf->ino = inode->i_ino;
+	}
+	return pf;
+}
+
+void __preload_record(struct file *filp, pgoff_t offset, unsigned long nr)
+{
+	struct inode *inode;
+	struct preload_file *pf;
+	struct preload_extent *pe;
+
+	if (!filp || !nr)
+		return;
+	inode = filp->f_mapping->host;
+	if (!S_ISREG(inode->i_mode))
+		return;
+
+	mutex_lock(&preload_lock);
+	if (preload_state != PRELOAD_RECORDING)
+		goto out;
+
+	pf = preload_find_inode(inode);
+	if (!pf) {
+		pf = preload_record_file(filp);
+		if (!pf) {
+			preload_stats.dropped++;
+			goto out;
+		}
+	}
+
+	/* Readahead windows of a file mostly continue the previous one */
+	if (pf->last != PRELOAD_NONE) {
+		pe = &preload_extents[pf->last];
+		if (offset >= pe->start && offset <= pe->start + pe->nr) {
+			pe->nr = max(pe->nr, offset + nr - pe->start);
+			goto out;
+		}
+	}
+	if (preload_add_extent(pf, offset, nr))
+		preload_stats.dropped++;
+out:
+	mutex_unlock(&preload_lock);
+}
+
+static void preload_open(struct preload_file *pf)
+{
+	struct file *filp;
+	struct path path;
+
+	/*
+	 * The list comes from userspace and the path may have been replaced
+	 * since. Only regular files are opened, a device node or FIFO is
+	 * never handed to its driver.
+	 */
+	if (kern_path(pf->path, LOOKUP_FOLLOW, &path)) {
+		preload_stats.files_missing++;
+		return;
+	}
+	if (!S_ISREG(path.dentry->d_inode->i_mode)) {
+		path_put(&path);
+		preload_stats.files_missing++;
+		return;
+	}
+
+	/* dentry_open() consumes the path references, even on failure */
+	filp = dentry_open(path.dentry, path.mnt,
+			   O_RDONLY | O_LARGEFILE | O_NOATIME, current_cred());
+	if (IS_ERR(filp)) {
+		preload_stats.files_missing++;
+		return;
+	}
+	pf->filp = filp;
+}
+
+static int preload_extent_cmp(const void *a, const void *b)
+{
+	const struct preload_extent *pa = a, *pb = b;
+
+	if (pa->dev != pb->dev)
+		return pa->dev < pb->dev ? -1 : 1;
+	if (pa->block != pb->block)
+		return pa->block < pb->block ? -1 : 1;
+	return 0;
+}
+
+static void preload_read_extent(struct preload_extent *pe)
+{
+	struct file *filp = preload_files[pe->file].filp;
+	struct address_space *mapping;
+	unsigned long nr = pe->nr;
+	pgoff_t end_index;
+	loff_t isize;
+	int ret;
+
+	if (!filp)
+		return;
+	mapping = filp->f_mapping;
+	isize = i_size_read(mapping->host);
+	if (!isize)
+		return;
+	end_index = (isize - 1) >> PAGE_CACHE_SHIFT;
+	if (pe->start > end_index)
+		return;
+	nr = min(nr, end_index - pe->start + 1);
+
+	ret = force_page_cache_readahead(mapping, filp, pe->start, nr);
+	if (ret < 0)
+		return;
+	preload_stats.pages_requested += nr;
+	preload_stats.pages_read += ret;
+	preload_stats.pages_cached += nr - min_t(unsigned long, ret, nr);
+}
+
+static int preload_replay(void *unused)
+{
+	struct blk_plug plug;
+	unsigned int i;
+
+	/* Lookups and inode reads are synchronous, get them over with */
+	for (i = 0; i < preload_nr_files; i++)
+		preload_open(&preload_files[i]);
+
+	mutex_lock(&preload_lock);
+	for (i = 0; i < preload_nr_extents; i++) {
+		struct preload_extent *pe = &preload_extents[i];
+		struct file *filp = preload_files[pe->file].filp;
+		struct inode *inode;
+
+		if (!filp)
+			continue;
+		inode = filp->f_mapping->host;
+		pe->dev = inode->i_sb->s_dev;
+		pe->block = bmap(inode, ((sector_t)pe->start <<
+					 PAGE_CACHE_SHIFT) >> inode->i_blkbits);
+	}
+	sort(preload_extents, preload_nr_extents, sizeof(*preload_extents),
+	     preload_extent_cmp, NULL);
+	for (i = 0; i < preload_nr_files; i++)
+		preload_files[i].last = PRELOAD_NONE;
+	mutex_unlock(&preload_lock);
+
+	/* All reads are async, let them pile up in disk order */
+	blk_start_plug(&plug);
+	for (i = 0; i < preload_nr_extents; i++)
+		preload_read_extent(&preload_extents[i]);
+	blk_finish_plug(&plug);
+
+	for (i = 0; i < preload_nr_files; i++) {
+		if (preload_files[i].filp)
+			fput(preload_files[i].filp);
+		preload_files[i].filp = NULL;
+	}
+
+	mutex_lock(&preload_lock);
+	preload_state = PRELOAD_IDLE;
+	mutex_unlock(&preload_lock);
+	return 0;
+}
+
+static int preload_control_show(struct seq_file *m, void *v)
+{
+	static const char * const states[] = {
+		[PRELOAD_IDLE]		= "idle",
+		[PRELOAD_RECORDING]	= "recording",
+		[PRELOAD_REPLAYING]	= "replaying",
+	};
+
+	mutex_lock(&preload_lock);
+	seq_printf(m, "state: %s\n", states[preload_state]);
+	seq_printf(m, "files: %u\n", preload_nr_files);
+	seq_printf(m, "extents: %u\n", preload_nr_extents);
+	seq_printf(m, "dropped: %lu\n", preload_stats.dropped);
+	seq_printf(m, "files missing: %lu\n", preload_stats.files_missing);
+	seq_printf(m, "pages requested: %lu\n",
+		   preload_stats.pages_requested);
+	seq_printf(m, "pages cached: %lu\n", preload_stats.pages_cached);
+	seq_printf(m, "pages read: %lu\n", preload_stats.pages_read);
+	mutex_unlock(&preload_lock);
+	return 0;
+}
+
+static int preload_control_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, preload_control_show, NULL);
+}
+
+static int preload_command(const char *cmd)
+{
+	struct task_struct *task;
+	int err;
+
+	if (!strcmp(cmd, "stop")) {
+		if (preload_state == PRELOAD_RECORDING) {
+			preload_recording = 0;
+			preload_state = PRELOAD_IDLE;
+			preload_rehash_names();
+		}
+		return 0;
+	}
+
+	if (preload_state != PRELOAD_IDLE)
+		return -EBUSY;
+
+	if (!strcmp(cmd, "record")) {
+		preload_clear();
+		err = preload_alloc();
+		if (err)
+			return err;
+		memset(&preload_stats, 0, sizeof(preload_stats));
+		preload_state = PRELOAD_RECORDING;
+		preload_recording = 1;
+	} else if (!strcmp(cmd, "replay")) {
+		if (!preload_nr_extents)
+			return -ENODATA;
+		memset(&preload_stats, 0, sizeof(preload_stats));
+		preload_state = PRELOAD_REPLAYING;
+		task = kthread_run(preload_replay, NULL, "preload");
+		if (IS_ERR(task)) {
+			preload_state = PRELOAD_IDLE;
+			return PTR_ERR(task);
+		}
+	} else if (!strcmp(cmd, "clear")) {
+		preload_clear();
+	} else {
+		return -EINVAL;
+	}
+	return 0;
+}
+
+static ssize_t preload_control_write(struct file *file,
+				     const char __user *ubuf,
+				     size_t count, loff_t *ppos)
+{
+	char buf[16];
+	int err;
+
+	if (count >= sizeof(buf))
+		return -EINVAL;
+	if (copy_from_user(buf, ubuf, count))
+		return -EFAULT;
+	buf[count] = '\0';
+
+	mutex_lock(&preload_lock);
+	err = preload_command(strstrip(buf));
+	mutex_unlock(&preload_lock);
+
+	return err ? err : count;
+}
+
+static const struct file_operations preload_control_fops = {
+	.open		= preload_control_open,
+	.read		= seq_read,
+	.write		= preload_control_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static void *preload_list_start(struct seq_file *m, loff_t *pos)
+{
+	mutex_lock(&preload_lock);
+	if (*pos >= preload_nr_extents)
+		return NULL;
+	return &preload_extents[*pos];
+}
+
+static void *preload_list_next(struct seq_file *m, void *v, loff_t *pos)
+{
+	++*pos;
+	if (*pos >= preload_nr_extents)
+		return NULL;
+	return &preload_extents[*pos];
+}
+
+static void preload_list_stop(struct seq_file *m, void *v)
+{
+	mutex_unlock(&preload_lock);
+}
+
+static int preload_list_show(struct seq_file *m, void *v)
+{
+	struct preload_extent *pe = v;
+
+	seq_printf(m, "%lu %lu %s\n", (unsigned long)pe->start, pe->nr,
+		   preload_files[pe->file].path);
+	return 0;
+}
+
+static const struct seq_operations preload_list_ops = {
+	.start	= preload_list_start,
+	.next	= preload_list_next,
+	.stop	= preload_list_stop,
+	.show	= preload_list_show,
+};
+
+static int preload_list_open(struct inode *inode, struct file *file)
+{
+	return seq_open(file, &preload_list_ops);
+}
+
+/* One "<start> <pages> <path>" line, as shown by the list file */
+static int preload_parse_line(char *line)
+{
+	struct preload_file *pf;
+	unsigned long start, nr;
+	char *path;
+	int n = 0;
+
+	if (!*line)
+		return 0;
+	if (sscanf(line, "%lu %lu %n", &start, &nr, &n) < 2 || !n)
+		return -EINVAL;
+	path = line + n;
+	if (*path != '/' || !nr)
+		return -EINVAL;
+
+	pf = preload_find_name(path);
+	if (!pf) {
+		pf = preload_add_file(path, preload_name_hash(path));
+		if (!pf)
+			return -ENOSPC;
+	}
+	return preload_add_extent(pf, start, nr);
+}
+
+static ssize_t preload_list_write(struct file *file, const char __user *ubuf,
+				  size_t count, loff_t *ppos)
+{
+	size_t len = min_t(size_t, count, PAGE_SIZE - 1);
+	char *buf, *line;
+	ssize_t done;
+	int err = 0;
+
+	buf = (char *)__get_free_page(GFP_KERNEL);
+	if (!buf)
+		return -ENOMEM;
+	if (copy_from_user(buf, ubuf, len)) {
+		free_page((unsigned long)buf);
+		return -EFAULT;
+	}
+	buf[len] = '\0';
+	line = buf;
+
+	mutex_lock(&preload_lock);
+	if (preload_state != PRELOAD_IDLE) {
+		err = -EBUSY;
+		goto out;
+	}
+	err = preload_alloc();
+	if (err)
+		goto out;
+
+	while (line < buf + len) {
+		char *end = strchr(line, '\n');
+
+		if (!end) {
+			/* A line cut by the page size is written again */
+			if (len < count)
+				break;
+			end = buf + len;
+		}
+		*end = '\0';
+		err = preload_parse_line(line);
+		if (err)
+			break;
+		line = end + 1;
+	}
+out:
+	mutex_unlock(&preload_lock);
+	free_page((unsigned long)buf);
+
+	done = min_t(size_t, line - buf, len);
+	if (!done)
+		return err ? err : -EINVAL;
+	return done;
+}
+
+static const struct file_operations preload_list_fops = {
+	.open		= preload_list_open,
+	.read		= seq_read,
+	.write		= preload_list_write,
+	.llseek		= seq_lseek,
+	.release	= seq_release,
+};
+
+static int __init preload_init(void)
+{
+	struct proc_dir_entry *dir;
+
+	dir = proc_mkdir("preload", NULL);
+	if (!dir)
+		return -ENOMEM;
+	proc_create("control", S_IRUSR | S_IWUSR, dir, &preload_control_fops);
+	proc_create("list", S_IRUSR | S_IWUSR, dir, &preload_list_fops);
+	return 0;
+}
+module_init(preload_init);
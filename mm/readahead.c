@@ -17,6 +17,7 @@
 #include <linux/task_io_accounting_ops.h>
 #include <linux/pagevec.h>
 #include <linux/pagemap.h>
+#include <linux/preload.h>
 
 /*
  * Initialise a struct file's readahead state.  Assumes that the caller has
@@ -164,6 +165,9 @@ __do_page_cache_readahead(struct address_space *mapping, struct file *filp,
 		goto out;
 
 	end_index = ((isize - 1) >> PAGE_CACHE_SHIFT);
+	if (offset <= end_index)
+		preload_record(filp, offset,
+			       min(nr_to_read, end_index - offset + 1));
 
 	/*
 	 * Preallocate as many pages as we will need.
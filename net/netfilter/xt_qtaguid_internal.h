@@ -11,8 +11,12 @@
 #define __XT_QTAGUID_INTERNAL_H__
 
 #include <linux/types.h>
+#include <linux/cpumask.h>
 #include <linux/rbtree.h>
+#include <linux/rcupdate.h>
 #include <linux/spinlock_types.h>
+#include <linux/string.h>
+#include <linux/u64_stats_sync.h>
 #include <linux/workqueue.h>
 
 /* Iface handling */
@@ -185,16 +189,57 @@ struct tag_node {
 	tag_t tag;
 };
 
+/*
+ * Each cpu only ever touches its own copy from the packet path, so no
+ * lock is needed to update it. syncp lets 32-bit readers get a
+ * consistent 64-bit snapshot.
+ */
+struct data_counters_cpu {
+	struct data_counters counters;
+	struct u64_stats_sync syncp;
+} ____cacheline_aligned_in_smp;
+
 struct tag_stat {
 	struct tag_node tn;
-	struct data_counters counters;
+	struct hlist_node hash_node;  /* in iface_stat.tag_stat_hash */
+	struct rcu_head rcu;
 	/*
 	 * If this tag is acct_tag based, we need to count against the
 	 * matching parent uid_tag.
 	 */
-	struct data_counters *parent_counters;
+	struct tag_stat *parent;
+	/* nr_cpu_ids entries, use tag_stat_sum_counters() to read them */
+	struct data_counters_cpu cpu_counters[0];
 };
 
+static inline void tag_stat_sum_counters(const struct tag_stat *ts,
+					 struct data_counters *sum)
+{
+	const int n = sizeof(*sum) / sizeof(uint64_t);
+	uint64_t *dst = (uint64_t *)sum;
+	int cpu, i;
+
+	memset(sum, 0, sizeof(*sum));
+	for_each_possible_cpu(cpu) {
+		const struct data_counters_cpu *dcc = &ts->cpu_counters[cpu];
+		const uint64_t *src = (const uint64_t *)&dcc->counters;
+		unsigned int start;
+		uint64_t v;
+
+		for (i = 0; i < n; i++) {
+			do {
+				start = u64_stats_fetch_begin_bh(&dcc->syncp);
+				v = src[i];
+			} while (u64_stats_fetch_retry_bh(&dcc->syncp,
+							  start));
+			dst[i] += v;
+		}
+	}
+}
+
+#define TAG_STAT_HASH_BITS 6
+#define TAG_STAT_HASH_SIZE (1 << TAG_STAT_HASH_BITS)
+
 struct iface_stat {
 	struct list_head list;  /* in iface_stat_list */
 	char *ifname;
@@ -217,7 +262,12 @@ struct iface_stat {
 
 	struct proc_dir_entry *proc_ptr;
 
+	/*
+	 * The tree is ordered for the stats dump and the hash is for the
+	 * lockless packet path. Both are updated under tag_stat_list_lock.
+	 */
 	struct rb_root tag_stat_tree;
+	struct hlist_head tag_stat_hash[TAG_STAT_HASH_SIZE];
 	spinlock_t tag_stat_list_lock;
 };
 
@@ -242,6 +292,10 @@ struct sock_tag {
 	struct list_head list;   /* in proc_qtu_data.sock_tag_list */
 	pid_t pid;
 
+	/* RCU lookup by sk for the packet path */
+	struct hlist_node hash_node;
+	struct rcu_head rcu;
+
 	tag_t tag;
 };
 
@@ -278,6 +332,8 @@ struct qtaguid_event_counts {
 /* Track the set active_set for the given tag. */
 struct tag_counter_set {
 	struct tag_node tn;
+	struct hlist_node hash_node;  /* RCU lookup by tag */
+	struct rcu_head rcu;
 	int active_set;
 };
 
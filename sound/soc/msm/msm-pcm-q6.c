@@ -41,6 +41,10 @@ struct snd_msm {
 
 #define PLAYBACK_NUM_PERIODS	8
 #define PLAYBACK_PERIOD_SIZE	2048
+#define PLAYBACK_MIN_NUM_PERIODS	2
+#define PLAYBACK_MAX_NUM_PERIODS	16
+#define PLAYBACK_MIN_PERIOD_SIZE	512
+#define PLAYBACK_LL_DSP_DEPTH	2
 #define CAPTURE_NUM_PERIODS	16
 #define CAPTURE_PERIOD_SIZE	320
 
@@ -77,10 +81,10 @@ static struct snd_pcm_hardware msm_pcm_hardware_playback = {
 	.channels_min =         1,
 	.channels_max =         2,
 	.buffer_bytes_max =     PLAYBACK_NUM_PERIODS * PLAYBACK_PERIOD_SIZE,
-	.period_bytes_min =	PLAYBACK_PERIOD_SIZE,
+	.period_bytes_min =	PLAYBACK_MIN_PERIOD_SIZE,
 	.period_bytes_max =     PLAYBACK_PERIOD_SIZE,
-	.periods_min =          PLAYBACK_NUM_PERIODS,
-	.periods_max =          PLAYBACK_NUM_PERIODS,
+	.periods_min =          PLAYBACK_MIN_NUM_PERIODS,
+	.periods_max =          PLAYBACK_MAX_NUM_PERIODS,
 	.fifo_size =            0,
 };
 
@@ -89,6 +93,17 @@ static unsigned int supported_sample_rates[] = {
 	8000, 11025, 12000, 16000, 22050, 24000, 32000, 44100, 48000
 };
 
+/* q6asm walks its buffer ring with a mask, so the count is a power of 2 */
+static unsigned int playback_periods[] = {
+	2, 4, 8, 16
+};
+
+static struct snd_pcm_hw_constraint_list constraints_playback_periods = {
+	.count = ARRAY_SIZE(playback_periods),
+	.list = playback_periods,
+	.mask = 0,
+};
+
 static uint32_t in_frame_info[CAPTURE_NUM_PERIODS][2];
 
 static struct snd_pcm_hw_constraint_list constraints_sample_rates = {
@@ -97,6 +112,75 @@ static struct snd_pcm_hw_constraint_list constraints_sample_rates = {
 	.mask = 0,
 };
 
+/*
+ * Playback position reporting. The PCM pointer still moves a period at a
+ * time on WRITE_DONE, since that is when the DSP is done reading the
+ * buffer. Each WRITE_DONE also asks the DSP for its rendered session
+ * time without blocking. runtime->delay is then the audio the DSP has
+ * taken but not yet played, interpolated since the last answer.
+ */
+static void msm_pcm_query_dsp_time(struct msm_audio *prtd, int rebase)
+{
+	unsigned long flags;
+	int query;
+
+	spin_lock_irqsave(&prtd->dsp_lock, flags);
+	query = !prtd->dsp_time_pending;
+	if (query) {
+		prtd->dsp_time_pending = 1;
+		prtd->dsp_time_rebase = rebase;
+	}
+	spin_unlock_irqrestore(&prtd->dsp_lock, flags);
+	if (query && q6asm_get_session_time_nowait(prtd->audio_client) < 0) {
+		spin_lock_irqsave(&prtd->dsp_lock, flags);
+		prtd->dsp_time_pending = 0;
+		spin_unlock_irqrestore(&prtd->dsp_lock, flags);
+	}
+}
+
+static void msm_pcm_update_dsp_time(struct msm_audio *prtd)
+{
+	uint64_t ts = prtd->audio_client->time_stamp;
+	unsigned long flags;
+
+	spin_lock_irqsave(&prtd->dsp_lock, flags);
+	if (prtd->dsp_time_rebase) {
+		/* answer to the query sent at RUN, nothing played yet */
+		prtd->dsp_time_base = ts;
+		prtd->dsp_time_rebase = 0;
+	} else if (ts >= prtd->dsp_time_base) {
+		prtd->dsp_time = ts - prtd->dsp_time_base;
+		prtd->dsp_time_ktime = ktime_get();
+	}
+	prtd->dsp_time_pending = 0;
+	spin_unlock_irqrestore(&prtd->dsp_lock, flags);
+}
+
+static snd_pcm_sframes_t msm_pcm_dsp_delay(struct snd_pcm_runtime *runtime,
+					struct msm_audio *prtd)
+{
+	uint64_t consumed, rendered, played_us;
+	unsigned long flags;
+
+	spin_lock_irqsave(&prtd->dsp_lock, flags);
+	if (!prtd->dsp_time_ktime.tv64) {
+		spin_unlock_irqrestore(&prtd->dsp_lock, flags);
+		return 0;
+	}
+	consumed = div_u64(prtd->bytes_consumed,
+			frames_to_bytes(runtime, 1));
+	played_us = prtd->dsp_time;
+	if (atomic_read(&prtd->start))
+		played_us += ktime_to_us(ktime_sub(ktime_get(),
+					prtd->dsp_time_ktime));
+	spin_unlock_irqrestore(&prtd->dsp_lock, flags);
+
+	rendered = div_u64(played_us * runtime->rate, USEC_PER_SEC);
+	if (rendered >= consumed)
+		return 0;
+	return min_t(uint64_t, consumed - rendered, runtime->buffer_size);
+}
+
 static void event_handler(uint32_t opcode,
 		uint32_t token, uint32_t *payload, void *priv)
 {
@@ -106,6 +190,7 @@ static void event_handler(uint32_t opcode,
 	int i = 0;
 	uint32_t idx = 0;
 	uint32_t size = 0;
+	unsigned long flags;
 
 	pr_debug("%s\n", __func__);
 	switch (opcode) {
@@ -113,6 +198,10 @@ static void event_handler(uint32_t opcode,
 		pr_debug("ASM_DATA_EVENT_WRITE_DONE\n");
 		pr_debug("Buffer Consumed = 0x%08x\n", *ptrmem);
 		prtd->pcm_irq_pos += prtd->pcm_count;
+		spin_lock_irqsave(&prtd->dsp_lock, flags);
+		prtd->bytes_consumed += prtd->pcm_count;
+		spin_unlock_irqrestore(&prtd->dsp_lock, flags);
+		msm_pcm_query_dsp_time(prtd, 0);
 		if (atomic_read(&prtd->start))
 			snd_pcm_period_elapsed(substream);
 		atomic_inc(&prtd->out_count);
@@ -131,6 +220,10 @@ static void event_handler(uint32_t opcode,
 		}
 		break;
 	}
+	case ASM_SESSION_CMDRSP_GET_SESSION_TIME:
+		if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK)
+			msm_pcm_update_dsp_time(prtd);
+		break;
 	case ASM_DATA_CMDRSP_EOS:
 		pr_debug("ASM_DATA_CMDRSP_EOS\n");
 		prtd->cmd_ack = 1;
@@ -165,14 +258,17 @@ static void event_handler(uint32_t opcode,
 				atomic_set(&prtd->start, 1);
 				break;
 			}
+			if (!prtd->bytes_consumed)
+				msm_pcm_query_dsp_time(prtd, 1);
 			if (prtd->mmap_flag) {
-				pr_debug("%s:writing %d bytes"
+				pr_debug("%s:writing %d x %d bytes"
 					" of buffer to dsp\n",
-					__func__,
+					__func__, prtd->dsp_depth,
 					prtd->pcm_count);
-				q6asm_write_nolock(prtd->audio_client,
-					prtd->pcm_count,
-					0, 0, NO_TIMESTAMP);
+				for (i = 0; i < prtd->dsp_depth; i++)
+					q6asm_write_nolock(prtd->audio_client,
+						prtd->pcm_count,
+						0, 0, NO_TIMESTAMP);
 			} else {
 				while (atomic_read(&prtd->out_needed)) {
 					pr_debug("%s:writing %d bytes"
@@ -212,6 +308,12 @@ static int msm_pcm_playback_prepare(struct snd_pcm_substream *substream)
 	/* rate and channels are sent to audio driver */
 	prtd->samp_rate = runtime->rate;
 	prtd->channel_mode = runtime->channels;
+	spin_lock_irq(&prtd->dsp_lock);
+	prtd->bytes_consumed = 0;
+	prtd->dsp_time = 0;
+	prtd->dsp_time_ktime = ktime_set(0, 0);
+	prtd->dsp_time_pending = 0;
+	spin_unlock_irq(&prtd->dsp_lock);
 	if (prtd->enabled)
 		return 0;
 
@@ -317,6 +419,7 @@ static int msm_pcm_open(struct snd_pcm_substream *substream)
 		return -ENOMEM;
 	}
 	prtd->substream = substream;
+	spin_lock_init(&prtd->dsp_lock);
 	prtd->audio_client = q6asm_audio_client_alloc(
 				(app_cb)event_handler, prtd);
 	if (!prtd->audio_client) {
@@ -326,6 +429,11 @@ static int msm_pcm_open(struct snd_pcm_substream *substream)
 	}
 	if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK) {
 		runtime->hw = msm_pcm_hardware_playback;
+		ret = snd_pcm_hw_constraint_list(runtime, 0,
+				SNDRV_PCM_HW_PARAM_PERIODS,
+				&constraints_playback_periods);
+		if (ret < 0)
+			pr_info("%s: periods constraint failed\n", __func__);
 		ret = q6asm_open_write(prtd->audio_client, FORMAT_LINEAR_PCM);
 		if (ret < 0) {
 			pr_err("%s: pcm out open failed\n", __func__);
@@ -586,6 +694,8 @@ static snd_pcm_uframes_t msm_pcm_pointer(struct snd_pcm_substream *substream)
 
 	if (prtd->pcm_irq_pos >= prtd->pcm_size)
 		prtd->pcm_irq_pos = 0;
+	if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK)
+		runtime->delay = msm_pcm_dsp_delay(runtime, prtd);
 
 	pr_debug("pcm_irq_pos = %d\n", prtd->pcm_irq_pos);
 	return bytes_to_frames(runtime, (prtd->pcm_irq_pos));
@@ -652,10 +762,29 @@ static int msm_pcm_hw_params(struct snd_pcm_substream *substream,
 			prtd->session_id, substream->stream);
 	}
 
+	/*
+	 * Small playback periods make this a low latency stream: the mmap
+	 * path then keeps more than one period queued at the DSP so the
+	 * WRITE_DONE round trip never leaves it waiting for data.
+	 */
+	prtd->dsp_depth = 1;
+	if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK &&
+		params_period_bytes(params) < PLAYBACK_PERIOD_SIZE)
+		prtd->dsp_depth = min_t(int, PLAYBACK_LL_DSP_DEPTH,
+					params_periods(params) - 1);
+
+	/* hw_params may be called again with a different geometry */
+	buf = prtd->audio_client->port[dir].buf;
+	if (buf && (buf[0].size != params_period_bytes(params) ||
+		prtd->audio_client->port[dir].max_buf_cnt !=
+			params_periods(params)))
+		q6asm_audio_client_buf_free_contiguous(dir,
+				prtd->audio_client);
+
 	ret = q6asm_audio_client_buf_alloc_contiguous(dir,
 			prtd->audio_client,
-			runtime->hw.period_bytes_min,
-			runtime->hw.periods_max);
+			params_period_bytes(params),
+			params_periods(params));
 	if (ret < 0) {
 		pr_err("Audio Start: Buffer Allocation failed \
 					rc = %d\n", ret);
@@ -671,7 +800,7 @@ static int msm_pcm_hw_params(struct snd_pcm_substream *substream,
 	dma_buf->private_data = NULL;
 	dma_buf->area = buf[0].data;
 	dma_buf->addr =  buf[0].phys;
-	dma_buf->bytes = runtime->hw.buffer_bytes_max;
+	dma_buf->bytes = params_buffer_bytes(params);
 	if (!dma_buf->area)
 		return -ENOMEM;
 
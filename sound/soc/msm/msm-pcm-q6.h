@@ -18,6 +18,7 @@
 
 #ifndef _MSM_PCM_H
 #define _MSM_PCM_H
+#include <linux/ktime.h>
 #include <sound/apr_audio.h>
 #include <sound/q6asm.h>
 
@@ -79,6 +80,16 @@ struct msm_audio {
 	int periods;
 	int mmap_flag;
 	atomic_t pending_buffer;
+	int dsp_depth;	/* buffers kept queued at the DSP in mmap mode */
+
+	/* DSP rendered position, protected by dsp_lock */
+	spinlock_t dsp_lock;
+	uint64_t bytes_consumed;
+	uint64_t dsp_time_base;
+	uint64_t dsp_time;
+	ktime_t dsp_time_ktime;
+	int dsp_time_pending;
+	int dsp_time_rebase;
 };
 
 #endif /*_MSM_PCM_H*/
@@ -3323,6 +3323,35 @@ fail_cmd:
 	return -EINVAL;
 }
 
+/*
+ * Ask for the rendered session time without waiting for it. The answer
+ * lands in ac->time_stamp and is passed to the client callback as
+ * ASM_SESSION_CMDRSP_GET_SESSION_TIME, so this is safe to call from the
+ * callback itself.
+ */
+int q6asm_get_session_time_nowait(struct audio_client *ac)
+{
+	struct apr_hdr hdr;
+	int rc;
+
+	if (!ac || ac->apr == NULL) {
+		pr_err("APR handle NULL\n");
+		return -EINVAL;
+	}
+	q6asm_add_hdr_async(ac, &hdr, sizeof(hdr), FALSE);
+	hdr.opcode = ASM_SESSION_CMD_GET_SESSION_TIME;
+
+	pr_debug("%s: session[%d]opcode[0x%x]\n", __func__,
+						ac->session,
+						hdr.opcode);
+	rc = apr_send_pkt(ac->apr, (uint32_t *) &hdr);
+	if (rc < 0) {
+		pr_err("Commmand 0x%x failed\n", hdr.opcode);
+		return -EINVAL;
+	}
+	return 0;
+}
+
 int q6asm_cmd(struct audio_client *ac, int cmd)
 {
 	struct apr_hdr hdr;